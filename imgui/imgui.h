@@ -2975,6 +2975,7 @@ enum ImFontAtlasFlags_
     ImFontAtlasFlags_NoPowerOfTwoHeight = 1 << 0,   // Don't round the height to next power of two
     ImFontAtlasFlags_NoMouseCursors     = 1 << 1,   // Don't build software mouse cursors into the atlas (save a little texture memory)
     ImFontAtlasFlags_NoBakedLines       = 1 << 2,   // Don't build thick line textures into the atlas (save a little texture memory, allow support for point/nearest filtering). The AntiAliasedLinesUseTex features uses them, otherwise they will be rendered using polygons (more expensive for CPU/GPU).
+    ImFontAtlasFlags_SignedDistanceField = 1 << 3,  // Rasterize glyphs as signed distance fields so they stay sharp at any scale (stb_truetype builder only, implies ImFontAtlasFlags_NoBakedLines). The renderer backend needs to threshold the atlas alpha around 128/255 instead of using it as coverage. Custom rects (mouse cursors, AddCustomRectXXX() content) still hold coverage, which the backend has to convert.
 };
 
 // Load and rasterize multiple TTF/OTF fonts into a same texture. The font atlas will build a single texture holding:
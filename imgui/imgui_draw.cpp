@@ -2377,6 +2377,11 @@ bool    ImFontAtlas::Build()
         IM_ASSERT(0); // Invalid Build function
 #endif
     }
+#ifdef IMGUI_ENABLE_STB_TRUETYPE
+    IM_ASSERT((!(Flags & ImFontAtlasFlags_SignedDistanceField) || builder_io == ImFontAtlasGetBuilderForStbTruetype()) && "ImFontAtlasFlags_SignedDistanceField needs the stb_truetype builder!");
+#else
+    IM_ASSERT(!(Flags & ImFontAtlasFlags_SignedDistanceField) && "ImFontAtlasFlags_SignedDistanceField needs the stb_truetype builder!");
+#endif
 
     // Build
     return builder_io->FontBuilder_Build(this);
@@ -2438,11 +2443,53 @@ static void UnpackBitVectorToFlatIndexList(const ImBitVector* in, ImVector<int>*
                     out->push_back((int)(((it - it_begin) << 5) + bit_n));
 }
 
+// Distance fields stored by ImFontAtlasFlags_SignedDistanceField: the glyph edge maps to FONT_ATLAS_SDF_ON_EDGE
+// and the alpha falls to 0 FONT_ATLAS_SDF_PADDING pixels outside of it, which bounds how far glyphs can be shrunk.
+static const int FONT_ATLAS_SDF_PADDING = 4;
+static const unsigned char FONT_ATLAS_SDF_ON_EDGE = 128;
+
+// Render distance fields into the packed rectangles and fill in the packed chars stbtt_PackFontRangesRenderIntoRects() would have
+static void ImFontAtlasBuildRenderSDFGlyphs(ImFontAtlas* atlas, const ImFontConfig& cfg, const stbtt_fontinfo& font_info, const int* codepoints, int glyphs_count, const stbrp_rect* rects, stbtt_packedchar* packed_chars)
+{
+    const float scale = (cfg.SizePixels > 0) ? stbtt_ScaleForPixelHeight(&font_info, cfg.SizePixels) : stbtt_ScaleForMappingEmToPixels(&font_info, -cfg.SizePixels);
+    const float pixel_dist_scale = (float)FONT_ATLAS_SDF_ON_EDGE / FONT_ATLAS_SDF_PADDING;
+    for (int glyph_i = 0; glyph_i < glyphs_count; glyph_i++)
+    {
+        const stbrp_rect& r = rects[glyph_i];
+        stbtt_packedchar& pc = packed_chars[glyph_i];
+        const int glyph_index_in_font = stbtt_FindGlyphIndex(&font_info, codepoints[glyph_i]);
+        int advance, lsb;
+        stbtt_GetGlyphHMetrics(&font_info, glyph_index_in_font, &advance, &lsb);
+        pc.xadvance = scale * advance;
+        if (!r.was_packed || r.w == 0 || r.h == 0)
+            continue;
+
+        int w, h, xoff, yoff;
+        unsigned char* sdf = stbtt_GetGlyphSDF(&font_info, scale, glyph_index_in_font, FONT_ATLAS_SDF_PADDING, FONT_ATLAS_SDF_ON_EDGE, pixel_dist_scale, &w, &h, &xoff, &yoff);
+        if (sdf == NULL)
+            continue;
+        IM_ASSERT(w + atlas->TexGlyphPadding <= r.w && h + atlas->TexGlyphPadding <= r.h);
+        for (int y = 0; y < h; y++)
+            memcpy(atlas->TexPixelsAlpha8 + (r.y + y) * atlas->TexWidth + r.x, sdf + y * w, (size_t)w);
+        stbtt_FreeSDF(sdf, font_info.userdata);
+
+        pc.x0 = (unsigned short)r.x;
+        pc.y0 = (unsigned short)r.y;
+        pc.x1 = (unsigned short)(r.x + w);
+        pc.y1 = (unsigned short)(r.y + h);
+        pc.xoff = (float)xoff;
+        pc.yoff = (float)yoff;
+        pc.xoff2 = (float)(xoff + w);
+        pc.yoff2 = (float)(yoff + h);
+    }
+}
+
 static bool ImFontAtlasBuildWithStbTruetype(ImFontAtlas* atlas)
 {
     IM_ASSERT(atlas->ConfigData.Size > 0);
 
     ImFontAtlasBuildInit(atlas);
+    const bool sdf = (atlas->Flags & ImFontAtlasFlags_SignedDistanceField) != 0;
 
     // Clear atlas
     atlas->TexID = (ImTextureID)NULL;
@@ -2573,6 +2620,10 @@ static bool ImFontAtlasBuildWithStbTruetype(ImFontAtlas* atlas)
         src_tmp.PackRange.h_oversample = (unsigned char)cfg.OversampleH;
         src_tmp.PackRange.v_oversample = (unsigned char)cfg.OversampleV;
 
+        // Distance fields interpolate well on their own, oversampling would only waste texture space
+        if (sdf)
+            src_tmp.PackRange.h_oversample = src_tmp.PackRange.v_oversample = 1;
+
         // Gather the sizes of all rectangles we will need to pack (this loop is based on stbtt_PackFontRangesGatherRects)
         const float scale = (cfg.SizePixels > 0) ? stbtt_ScaleForPixelHeight(&src_tmp.FontInfo, cfg.SizePixels) : stbtt_ScaleForMappingEmToPixels(&src_tmp.FontInfo, -cfg.SizePixels);
         const int padding = atlas->TexGlyphPadding;
@@ -2581,9 +2632,20 @@ static bool ImFontAtlasBuildWithStbTruetype(ImFontAtlas* atlas)
             int x0, y0, x1, y1;
             const int glyph_index_in_font = stbtt_FindGlyphIndex(&src_tmp.FontInfo, src_tmp.GlyphsList[glyph_i]);
             IM_ASSERT(glyph_index_in_font != 0);
-            stbtt_GetGlyphBitmapBoxSubpixel(&src_tmp.FontInfo, glyph_index_in_font, scale * cfg.OversampleH, scale * cfg.OversampleV, 0, 0, &x0, &y0, &x1, &y1);
-            src_tmp.Rects[glyph_i].w = (stbrp_coord)(x1 - x0 + padding + cfg.OversampleH - 1);
-            src_tmp.Rects[glyph_i].h = (stbrp_coord)(y1 - y0 + padding + cfg.OversampleV - 1);
+            if (sdf)
+            {
+                // Same size as the bitmap stbtt_GetGlyphSDF() returns, empty glyphs don't get one
+                stbtt_GetGlyphBitmapBox(&src_tmp.FontInfo, glyph_index_in_font, scale, scale, &x0, &y0, &x1, &y1);
+                const bool empty = (x0 == x1 || y0 == y1);
+                src_tmp.Rects[glyph_i].w = empty ? 0 : (stbrp_coord)(x1 - x0 + FONT_ATLAS_SDF_PADDING * 2 + padding);
+                src_tmp.Rects[glyph_i].h = empty ? 0 : (stbrp_coord)(y1 - y0 + FONT_ATLAS_SDF_PADDING * 2 + padding);
+            }
+            else
+            {
+                stbtt_GetGlyphBitmapBoxSubpixel(&src_tmp.FontInfo, glyph_index_in_font, scale * cfg.OversampleH, scale * cfg.OversampleV, 0, 0, &x0, &y0, &x1, &y1);
+                src_tmp.Rects[glyph_i].w = (stbrp_coord)(x1 - x0 + padding + cfg.OversampleH - 1);
+                src_tmp.Rects[glyph_i].h = (stbrp_coord)(y1 - y0 + padding + cfg.OversampleV - 1);
+            }
             total_surface += src_tmp.Rects[glyph_i].w * src_tmp.Rects[glyph_i].h;
         }
     }
@@ -2637,6 +2699,13 @@ static bool ImFontAtlasBuildWithStbTruetype(ImFontAtlas* atlas)
         if (src_tmp.GlyphsCount == 0)
             continue;
 
+        if (sdf)
+        {
+            ImFontAtlasBuildRenderSDFGlyphs(atlas, cfg, src_tmp.FontInfo, src_tmp.GlyphsList.Data, src_tmp.GlyphsCount, src_tmp.Rects, src_tmp.PackedChars);
+            src_tmp.Rects = NULL;
+            continue;
+        }
+
         stbtt_PackFontRangesRenderIntoRects(&spc, &src_tmp.FontInfo, &src_tmp.PackRange, 1, src_tmp.Rects);
 
         // Apply multiply operator
@@ -2875,6 +2944,10 @@ static void ImFontAtlasBuildRenderLinesTexData(ImFontAtlas* atlas)
 // Note: this is called / shared by both the stb_truetype and the FreeType builder
 void ImFontAtlasBuildInit(ImFontAtlas* atlas)
 {
+    // Baked lines hold coverage, which the distance field threshold of the renderer would alias
+    if (atlas->Flags & ImFontAtlasFlags_SignedDistanceField)
+        atlas->Flags |= ImFontAtlasFlags_NoBakedLines;
+
     // Round font size
     // - We started rounding in 1.90 WIP (18991) as our layout system currently doesn't support non-rounded font size well yet.
     // - Note that using io.FontGlobalScale or SetWindowFontScale(), with are legacy-ish, partially supported features, can still lead to unrounded sizes.
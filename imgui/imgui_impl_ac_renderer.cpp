@@ -1,6 +1,14 @@
+#include <chrono>
+#include <float.h>
 #include <list>
+#include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define IMGUI_IMPL_AC_STREAMING_STORES
+#endif
 #include "compiled/imgui.h"
 #include "imgui_impl_ac_renderer.hpp"
 
@@ -8,43 +16,373 @@
 #pragma warning(disable : 4127)
 #endif
 
+// Bindless array size, must match IMGUI_MAX_TEXTURES in imgui.acsl
 static constexpr uint32_t MAX_TEXTURES = 1024;
+// Texture sets per descriptor buffer page, a new page is created whenever all
+// sets of the previous ones are in use
+static constexpr uint32_t TEXTURE_PAGE_SIZE = 256;
+// Kinds of texture slots, must match the IMGUI_TEXTURE_* kinds in imgui.acsl
+static constexpr uint8_t  TEXTURE_COLOR = 0;
+static constexpr uint8_t  TEXTURE_ALPHA = 1;
+static constexpr uint8_t  TEXTURE_SDF = 2;
+// Composite images, whose sRGB encoded colors are decoded in sRGB targets
+static constexpr uint8_t  TEXTURE_COMPOSITE = 3;
+// Set in per vertex texture indices of single channel textures, must match
+// IMGUI_TEXTURE_ALPHA_BIT and IMGUI_TEXTURE_SDF_BIT in imgui.acsl
+static constexpr uint32_t TEXTURE_ALPHA_BIT = 0x80000000u;
+static constexpr uint32_t TEXTURE_SDF_BIT = 0x40000000u;
+// Set in the ids of streamed textures, whose low STREAMED_INDEX_BITS hold the
+// index offset by one and the bits above the generation of the entry, so ids
+// of recycled entries differ
+static constexpr uintptr_t STREAMED_TEXTURE_BIT =
+  (uintptr_t)1 << (sizeof(uintptr_t) * 8 - 1);
+static constexpr uint32_t  STREAMED_INDEX_BITS = 20;
+static constexpr uintptr_t STREAMED_INDEX_MASK =
+  ((uintptr_t)1 << STREAMED_INDEX_BITS) - 1;
+static constexpr uintptr_t STREAMED_GENERATION_MASK =
+  (STREAMED_TEXTURE_BIT - 1) >> STREAMED_INDEX_BITS;
+// Shape rounding and thickness are stored in SHAPE_PARAM_SCALE steps up to
+// SHAPE_PARAM_MAX, the steps must match IMGUI_SHAPE_PARAM_SCALE in imgui.acsl
+static constexpr float     SHAPE_PARAM_SCALE = 16.0f;
+static constexpr uint32_t  SHAPE_PARAM_MAX = 32767;
+// Font atlas rows compared and uploaded together on partial updates
+static constexpr int      FONT_BAND_HEIGHT = 32;
+// Edge value and steps per pixel of ImFontAtlasFlags_SignedDistanceField
+// distances, FONT_ATLAS_SDF_ON_EDGE and its ratio to FONT_ATLAS_SDF_PADDING
+// in imgui_draw.cpp
+static constexpr float    FONT_SDF_ON_EDGE = 128.0f;
+static constexpr float    FONT_SDF_PIXEL_DIST_SCALE = 32.0f;
+static constexpr uint64_t FONT_UPLOAD_ALIGNMENT = 512;
+static constexpr uint64_t MIN_RING_SLOT_SIZE = 64 * 1024;
+static constexpr uint64_t MIN_LIST_SLOT_SIZE = 4 * 1024;
+// Sub pixel steps of packed vertex positions, must match
+// IMGUI_PACKED_POSITION_SCALE of imgui.acsl
+static constexpr float    PACKED_POSITION_SCALE = 4.0f;
+// Pipelines kept before the least recently used one is destroyed
+static constexpr int      MAX_CACHED_PIPELINES = 16;
+// Smallest amount of draw data worth handing to a parallel_for_fn job
+static constexpr uint64_t MIN_COPY_JOB_SIZE = 256 * 1024;
+// Offscreen images of composited draw lists, sizes are rounded up to limit
+// reallocations while a window is resized
+static constexpr ac_format COMPOSITE_FORMAT = ac_format_r8g8b8a8_unorm;
+static constexpr uint32_t  COMPOSITE_SIZE_ALIGNMENT = 64;
+
+// Persistently mapped buffer split into frame_count equal slots. Each slot is
+// a linear allocator reset on the first allocation of a new frame, so data
+// written for frame N stays untouched until frame N + frame_count.
+struct ImGui_ImplACH_RingBuffer {
+  ac_buffer buffer;
+  uint8_t*  mapped;
+  uint64_t  slot_size;
+  uint64_t  head;
+  uint64_t  frame;
+};
 
+// Sub-ranges of the rings used by a single render call
 struct ImGui_ImplACH_FrameRenderBuffers {
   ac_buffer vertex_buffer;
+  uint64_t  vertex_offset;
   ac_buffer index_buffer;
+  uint64_t  index_offset;
+  // Per vertex texture indices, bindless_textures only
+  ac_buffer texture_buffer;
+  uint64_t  texture_offset;
+  // Per draw clip rectangles and arguments, indirect_draws only
+  ac_buffer clip_buffer;
+  uint64_t  clip_offset;
+  ac_buffer indirect_buffer;
+  uint64_t  indirect_offset;
+  // Vertex layout of the upload, packed positions are relative to
+  // pack_origin. Falls back to ImDrawVert when a vertex is out of range.
+  bool      packed;
+  float     pack_origin[2];
+};
+
+// Same layout as the indexed indirect arguments of every ac backend
+struct ImGui_ImplACH_DrawIndexedIndirect {
+  uint32_t index_count;
+  uint32_t instance_count;
+  uint32_t first_index;
+  int32_t  vertex_offset;
+  uint32_t first_instance;
+};
+
+// Indirect draws recorded with a single call, followed by an optional user
+// callback which has to run on the CPU between two batches
+struct ImGui_ImplACH_IndirectBatch {
+  uint32_t          first_draw;
+  uint32_t          draw_count;
+  const ImDrawList* cmd_list;
+  const ImDrawCmd*  callback;
+};
+
+// GPU copy of one draw list, cache_draw_lists only. The buffer has
+// frame_count slots but only moves to the next one when the content changes,
+// so a slot is rewritten at least frame_count frames after it was last read.
+struct ImGui_ImplACH_ListCacheEntry {
+  const ImDrawList* cmd_list;
+  uint64_t          hash;
+  ac_buffer         buffer;
+  uint8_t*          mapped;
+  uint64_t          slot_size;
+  uint32_t          slot;
+  uint64_t          written_frame;
+  uint64_t          used_frame;
+};
+
+// Where the geometry of a draw list was found for the current upload
+struct ImGui_ImplACH_ListRange {
+  ac_buffer buffer;
+  uint64_t  vertex_offset;
+  uint64_t  index_offset;
+};
+
+// Draw list rendered into an offscreen image and drawn as a single quad while
+// its content doesn't change. Images rotate like the list cache slots.
+struct ImGui_ImplACH_CompositeEntry {
+  const ImDrawList* cmd_list;
+  uint64_t          hash;
+  ac_image          images[AC_MAX_FRAME_IN_FLIGHT];
+  ImTextureID       textures[AC_MAX_FRAME_IN_FLIGHT];
+  uint32_t          image_width;
+  uint32_t          image_height;
+  uint32_t          current;
+  // Framebuffer rectangle covered by the list, x y width height
+  int32_t           rect[4];
+  // frame_count slots of 4 vertices and 6 indices
+  ac_buffer         quad_buffer;
+  uint8_t*          quad_mapped;
+  uint64_t          written_frame;
+  uint64_t          used_frame;
+};
+
+struct ImGui_ImplAC_Data;
+struct ImGui_ImplACH_WindowRenderBuffers;
+
+// Consecutive draw lists recorded together, with the offsets of their first
+// vertex and index in the uploaded range
+struct ImGui_ImplACH_DrawRange {
+  int                     first_list;
+  int                     list_count;
+  int                     vtx_offset;
+  int                     idx_offset;
+  ac_imgui_renderer_stats stats;
+  // Set by ac_imgui_renderer_begin_draw_ranges(), recording threads can't
+  // look them up through the current ImGui context
+  ImGui_ImplAC_Data*                 bd;
+  ImGui_ImplACH_WindowRenderBuffers* wrb;
+  ImDrawData*                        draw_data;
+};
+
+// Vertex uploaded with packed_vertices, matching VSInputPacked of imgui.acsl
+struct ImGui_ImplACH_PackedVert {
+  int16_t  pos[2];
+  uint16_t uv[2];
+  ImU32    col;
+};
+static_assert(sizeof(ImGui_ImplACH_PackedVert) == 12, "Unexpected padding");
+
+// Draw lists copied by one parallel_for_fn job. The vertex layout is
+// resolved on the calling thread, jobs don't read the ImGui context.
+struct ImGui_ImplACH_CopyJob {
+  ImDrawList* const* cmd_lists;
+  int                list_count;
+  uint8_t*           vtx_dst;
+  ImDrawIdx*         idx_dst;
+  uint32_t           stride;
+  bool               packed;
+  float              origin[2];
+  // Written by the job, a packed position or uv was out of range
+  bool               out_of_range;
 };
 
 struct ImGui_ImplACH_WindowRenderBuffers {
-  uint32_t                          Index;
-  uint32_t                          Count;
-  ImGui_ImplACH_FrameRenderBuffers* FrameRenderBuffers;
+  ImGui_ImplACH_RingBuffer vertex_ring;
+  ImGui_ImplACH_RingBuffer index_ring;
+  // gpu_only copy destination when device_local_draw_buffers is set
+  ImGui_ImplACH_RingBuffer device_ring;
+
+  // Ranges written by the last upload, reused by the following render calls
+  // for the same draw data within the frame
+  ImGui_ImplACH_FrameRenderBuffers      upload;
+  ImDrawData*                           upload_draw_data;
+  uint64_t                              upload_frame;
+  int                                   upload_imgui_frame;
+  ImVector<ImGui_ImplACH_IndirectBatch> indirect_batches;
+
+  // Hash of the draw data last checked by
+  // ac_imgui_renderer_draw_data_changed
+  uint64_t content_hash;
+
+  // Draw list cache and the range of every list of the last upload
+  ImVector<ImGui_ImplACH_ListCacheEntry> list_cache;
+  ImVector<ImGui_ImplACH_ListRange>      list_ranges;
+
+  // Composited draw lists and, for the last upload, the entry replacing every
+  // list or -1
+  ImVector<ImGui_ImplACH_CompositeEntry> composites;
+  ImVector<int32_t>                      list_composites;
+
+  // Mapped destinations of the last upload, filled by the draw ranges when
+  // the copies are deferred to them
+  uint8_t*                          vertex_dst;
+  ImDrawIdx*                        index_dst;
+  ImVector<ImGui_ImplACH_DrawRange> draw_ranges;
+  ac_pipeline                       range_pipeline;
+  ac_imgui_renderer_render_info     range_info;
+};
+
+// Layout of PCData in imgui.acsl
+struct ImGui_ImplACH_PushConstants {
+  float    scale[2];
+  float    translate[2];
+  // Target offset added to the clip rectangles of indirect draws, kept after
+  // translate so the float2 stays 8 byte aligned under std430 packing
+  float    clip_offset[2];
+  // TEXTURE_* kind of the bound texture, TEXTURE_ALPHA and TEXTURE_SDF only
+  // have a red channel holding alpha or a distance
+  uint32_t texture_kind;
+  // Framebuffer pixels per ImGui unit, scales the shape parameters
+  float    shape_scale;
+  // Non zero when the bound texture is the font atlas, the only one whose
+  // draws can hold ac_imgui_renderer_add_* shapes
+  uint32_t shape_texture;
+  // Non zero when the target has an sRGB format, vertex colors are then
+  // linearized so blending happens in linear space
+  uint32_t linear_colors;
+};
+
+// Last state recorded into the command buffer, used to skip redundant binds
+struct ImGui_ImplACH_BoundState {
+  // Backend recorded for, passed along because ranges record on other threads
+  ImGui_ImplAC_Data*          bd;
+  int32_t                     list;
+  uint32_t                    page;
+  uint32_t                    texture;
+  int32_t                     scissor[4];
+  ImGui_ImplACH_PushConstants push_constants;
+  bool                        push_constants_valid;
+  // Counters to update, owned by the range when recording in parallel
+  ac_imgui_renderer_stats*    stats;
+  // Position of the draw data in the target and the x0, y0, x1, y1 bounds
+  // every scissor is clamped to
+  int32_t                     offset[2];
+  int32_t                     bounds[4];
+  bool                        linear_colors;
+};
+
+// Consecutive commands which can be recorded as a single draw call
+struct ImGui_ImplACH_PendingDraw {
+  uint32_t index_count;
+  uint32_t first_index;
+  int32_t  vertex_offset;
+  uint32_t texture;
+  int32_t  scissor[4];
+};
+
+// Texture whose image is loaded on demand. texture is the slot of the
+// resident image or nullptr.
+struct ImGui_ImplACH_StreamedTexture {
+  uint64_t    user_key;
+  ImTextureID placeholder;
+  ImTextureID texture;
+  ac_image    image;
+  uint64_t    memory_size;
+  uint32_t    extent;
+  // Largest extent drawn this frame and the extent of the pending request
+  uint32_t    wanted_extent;
+  uint32_t    requested_extent;
+  uint64_t    used_frame;
+  // Bumped when the entry is destroyed, part of the id
+  uintptr_t   generation;
+  bool        alive;
+};
+
+// Cached pipeline and the last frame it was used in
+struct ImGui_ImplACH_PipelineEntry {
+  ac_imgui_renderer_pipeline_key key;
+  bool                           packed;
+  ac_pipeline                    pipeline;
+  uint64_t                       used_frame;
+};
+
+// Buffer or image kept alive until the GPU is guaranteed to be done with it
+struct ImGui_ImplAC_Garbage {
+  ac_buffer buffer;
+  ac_image  image;
+  uint64_t  frame;
 };
 
 struct ImGui_ImplAC_Data {
   ac_imgui_renderer_init_info init_info;
   uint64_t                    buffer_memory_alignment;
   ac_dsl                      dsl;
-  ac_descriptor_buffer        db;
-  uint32_t                    stack[MAX_TEXTURES];
-  int32_t                     stack_size;
-  ac_format                   pipeline_format;
-  ac_pipeline                 pipelines[2];
   ac_shader                   vertex_shader;
+  // Vertex shader of the packed pipelines, packed_vertices only
+  ac_shader                   packed_vertex_shader;
   ac_shader                   pixel_shader;
 
-  struct {
-    uint32_t released[MAX_TEXTURES];
-    int32_t  released_size;
-  } sets[2];
+  // Pipelines by target, most recently used first, and the one drawing
+  // composited lists with premultiplied alpha in the current render
+  ImVector<ImGui_ImplACH_PipelineEntry> pipelines;
+  ac_pipeline                           composite_pipeline;
+
+  // Texture slots. Slot s lives in set s % TEXTURE_PAGE_SIZE of page
+  // s / TEXTURE_PAGE_SIZE, or at index s of the single bindless page.
+  // Destroyed slots wait frame_count frames before they are reused.
+  ImVector<ac_descriptor_buffer> texture_pages;
+  ImVector<uint32_t>             free_slots;
+  ImVector<uint32_t>             released_slots[AC_MAX_FRAME_IN_FLIGHT];
+  // Kind passed to ImGui_ImplAC_CreateTexture for each slot
+  ImVector<uint8_t>              slot_kinds;
   // Font data
   ac_sampler  font_sampler;
   ac_image    font_image;
   ImTextureID font_set;
-  ac_buffer   staging_buffer;
+  // Copy of the uploaded atlas with partial_font_updates, diffed against the
+  // next one to only upload the bands that changed
+  ImVector<unsigned char> font_pixels;
+  int                     font_width;
+  int                     font_height;
+  int                     font_bytes_per_pixel;
+
+  // Frame in flight tracking, advanced by ac_imgui_renderer_new_frame
+  uint64_t                       frame;
+  uint32_t                       frame_index;
+  ImVector<ImGui_ImplAC_Garbage> garbage;
+
+  // Scratch space to build per vertex texture indices and indirect draws in
+  // cached memory
+  ImVector<uint32_t>                          texture_indices;
+  ImVector<ImVec4>                            indirect_clips;
+  ImVector<ImGui_ImplACH_DrawIndexedIndirect> indirect_draws;
+  ImVector<ImGui_ImplACH_CopyJob>             copy_jobs;
 
-  // Render buffers for main window
-  ImGui_ImplACH_WindowRenderBuffers MainWindowRenderBuffers;
+  // Counters of the current frame, reset by ac_imgui_renderer_new_frame
+  ac_imgui_renderer_stats stats;
+
+  // Bumped whenever texture contents or ids change, which the draw data hash
+  // can't see
+  uint64_t texture_generation;
+
+  // Streamed textures, the indices of destroyed entries, the entries drawn
+  // this frame and the memory of the resident images
+  ImVector<ImGui_ImplACH_StreamedTexture> streamed_textures;
+  ImVector<uint32_t>                      free_streamed_textures;
+  ImVector<uint32_t>                      drawn_streamed_textures;
+  uint64_t                                streamed_texture_bytes;
+
+  // Stats of the previous frame, for ac_imgui_renderer_show_stats_window
+  ac_imgui_renderer_stats last_stats;
+
+  // Lists passed to ac_imgui_renderer_composite_draw_list this frame
+  ImVector<const ImDrawList*> composite_requests;
+
+  // Contexts sharing this renderer, and the draw data of all contexts
+  // rendered by ac_imgui_renderer_render_draw_data_batch() with its buffers
+  int                               context_count;
+  ImDrawData                        batch_draw_data;
+  ImGui_ImplACH_WindowRenderBuffers BatchRenderBuffers;
 
   ImGui_ImplAC_Data()
   {
@@ -53,6 +391,17 @@ struct ImGui_ImplAC_Data {
   }
 };
 
+// Stored in ImGuiViewport::RendererUserData of every viewport, the main
+// viewport of each context sharing the renderer has its own
+struct ImGui_ImplAC_ViewportData {
+  ImGui_ImplACH_WindowRenderBuffers RenderBuffers;
+
+  ImGui_ImplAC_ViewportData()
+  {
+    AC_ZEROP(this);
+  }
+};
+
 static ImGui_ImplAC_Data*
 ImGui_ImplAC_GetBackendData()
 {
@@ -61,6 +410,25 @@ ImGui_ImplAC_GetBackendData()
            : nullptr;
 }
 
+// Every viewport has its own rings and caches, so uploading the draw data of
+// one viewport or context does not overwrite the upload of another within
+// the frame. Draw data without an owner uses the main viewport of the current
+// context.
+static ImGui_ImplACH_WindowRenderBuffers*
+ImGui_ImplAC_GetWindowRenderBuffers(ImDrawData* draw_data)
+{
+  ImGuiViewport* viewport = draw_data->OwnerViewport;
+  if (!viewport || !viewport->RendererUserData)
+  {
+    viewport = ImGui::GetMainViewport();
+  }
+  IM_ASSERT(
+    viewport->RendererUserData &&
+    "Did you call ac_imgui_renderer_add_context() for this context?");
+  return &((ImGui_ImplAC_ViewportData*)viewport->RendererUserData)
+            ->RenderBuffers;
+}
+
 static void
 check_ac_result(ac_result err)
 {
@@ -76,33 +444,440 @@ check_ac_result(ac_result err)
   }
 }
 
+static uint64_t
+ImGui_ImplAC_AlignUp(uint64_t size, uint64_t alignment)
+{
+  return ((size + alignment - 1) / alignment) * alignment;
+}
+
+static void
+ImGui_ImplAC_DestroyRingBuffer(ImGui_ImplACH_RingBuffer* ring)
+{
+  if (ring->buffer)
+  {
+    if (ring->mapped)
+    {
+      ac_buffer_unmap_memory(ring->buffer);
+    }
+    ac_destroy_buffer(ring->buffer);
+  }
+  memset(ring, 0, sizeof(*ring));
+}
+
+// Hands the buffer of the ring to the garbage list, for draws which were
+// already recorded from it
+static void
+ImGui_ImplAC_RetireRingBuffer(ImGui_ImplACH_RingBuffer* ring)
+{
+  ImGui_ImplAC_Data* bd = ImGui_ImplAC_GetBackendData();
+  if (ring->buffer)
+  {
+    if (ring->mapped)
+    {
+      ac_buffer_unmap_memory(ring->buffer);
+    }
+    ImGui_ImplAC_Garbage garbage = {};
+    garbage.buffer = ring->buffer;
+    garbage.frame = bd->frame;
+    bd->garbage.push_back(garbage);
+  }
+  memset(ring, 0, sizeof(*ring));
+}
+
+// Copies into write-combined memory with non-temporal stores, which skip
+// reading the destination lines into the cache. Follow a batch of copies with
+// ImGui_ImplAC_StreamFence().
+static void
+ImGui_ImplAC_StreamCopy(void* dst, const void* src, size_t size)
+{
+#ifdef IMGUI_IMPL_AC_STREAMING_STORES
+  uint8_t*       d = (uint8_t*)dst;
+  const uint8_t* s = (const uint8_t*)src;
+  size_t         head = (16 - ((uintptr_t)d & 15)) & 15;
+  if (head > size)
+  {
+    head = size;
+  }
+  memcpy(d, s, head);
+  d += head;
+  s += head;
+  size -= head;
+  for (; size >= 64; size -= 64, d += 64, s += 64)
+  {
+    __m128i a = _mm_loadu_si128((const __m128i*)(s + 0));
+    __m128i b = _mm_loadu_si128((const __m128i*)(s + 16));
+    __m128i c = _mm_loadu_si128((const __m128i*)(s + 32));
+    __m128i e = _mm_loadu_si128((const __m128i*)(s + 48));
+    _mm_stream_si128((__m128i*)(d + 0), a);
+    _mm_stream_si128((__m128i*)(d + 16), b);
+    _mm_stream_si128((__m128i*)(d + 32), c);
+    _mm_stream_si128((__m128i*)(d + 48), e);
+  }
+  memcpy(d, s, size);
+#else
+  memcpy(dst, src, size);
+#endif
+}
+
+// Makes the streamed data visible before the submit which follows
+static void
+ImGui_ImplAC_StreamFence()
+{
+#ifdef IMGUI_IMPL_AC_STREAMING_STORES
+  _mm_sfence();
+#endif
+}
+
+static uint64_t
+ImGui_ImplAC_GetMicroseconds()
+{
+  return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+           std::chrono::steady_clock::now().time_since_epoch())
+    .count();
+}
+
+// Adds the time since start to a stats counter in milliseconds
+static void
+ImGui_ImplAC_AddElapsed(float* counter, uint64_t start)
+{
+  *counter += (float)(ImGui_ImplAC_GetMicroseconds() - start) / 1000.0f;
+}
+
 static void
-CreateOrResizeBuffer(
-  ac_buffer&           buffer,
-  uint64_t             new_size,
-  ac_buffer_usage_bits usage)
+ImGui_ImplAC_GpuScope(
+  const ImGui_ImplAC_Data* bd,
+  ac_cmd                   command_buffer,
+  const char*              name,
+  bool                     begin)
+{
+  const ac_imgui_renderer_init_info* v = &bd->init_info;
+  if (v->gpu_scope_fn)
+  {
+    v->gpu_scope_fn(command_buffer, name, begin, v->gpu_scope_user_data);
+  }
+}
+
+// Size of an uploaded vertex
+static uint32_t
+ImGui_ImplAC_GetVertexStride(bool packed)
+{
+  return packed ? sizeof(ImGui_ImplACH_PackedVert) : sizeof(ImDrawVert);
+}
+
+// Returns false when v doesn't fit, the result is clamped
+static bool
+ImGui_ImplAC_PackPosition(float v, int16_t* packed)
+{
+  float p = v * PACKED_POSITION_SCALE;
+  p = p < 0.0f ? p - 0.5f : p + 0.5f;
+  bool in_range = p > -32768.5f && p < 32767.5f;
+  p = p < -32768.0f ? -32768.0f : (p > 32767.0f ? 32767.0f : p);
+  *packed = (int16_t)p;
+  return in_range;
+}
+
+// Returns false when v is outside [0, 1], e.g. tiled images, the result is
+// clamped
+static bool
+ImGui_ImplAC_PackUV(float v, uint16_t* packed)
+{
+  bool in_range = v >= 0.0f && v <= 1.0f;
+  v = v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+  *packed = (uint16_t)(v * 65535.0f + 0.5f);
+  return in_range;
+}
+
+// Writes count vertices into mapped memory, packing their positions relative
+// to origin when packed. Returns false when a packed position or uv didn't
+// fit.
+static bool
+ImGui_ImplAC_WriteVertices(
+  void*             dst,
+  const ImDrawVert* src,
+  int               count,
+  bool              packed,
+  const float       origin[2])
+{
+  if (!packed)
+  {
+    ImGui_ImplAC_StreamCopy(dst, src, count * sizeof(ImDrawVert));
+    return true;
+  }
+
+  // Written in order so the write-combining buffers still fill up
+  ImGui_ImplACH_PackedVert* dst_vert = (ImGui_ImplACH_PackedVert*)dst;
+  bool                      in_range = true;
+  for (int i = 0; i < count; i++)
+  {
+    ImGui_ImplACH_PackedVert vert;
+    in_range &=
+      ImGui_ImplAC_PackPosition(src[i].pos.x - origin[0], &vert.pos[0]);
+    in_range &=
+      ImGui_ImplAC_PackPosition(src[i].pos.y - origin[1], &vert.pos[1]);
+    in_range &= ImGui_ImplAC_PackUV(src[i].uv.x, &vert.uv[0]);
+    in_range &= ImGui_ImplAC_PackUV(src[i].uv.y, &vert.uv[1]);
+    vert.col = src[i].col;
+    memcpy(&dst_vert[i], &vert, sizeof(vert));
+  }
+  return in_range;
+}
+
+// Fast non cryptographic 64-bit hash, reading 8 bytes per step
+static uint64_t
+ImGui_ImplAC_Hash(const void* data, size_t size, uint64_t seed)
+{
+  const uint64_t m0 = 0x9E3779B97F4A7C15ull;
+  const uint64_t m1 = 0xBF58476D1CE4E5B9ull;
+  const uint8_t* p = (const uint8_t*)data;
+  uint64_t       h = seed ^ (size * m0);
+  while (size > 0)
+  {
+    uint64_t k = 0;
+    size_t   n = size < 8 ? size : 8;
+    memcpy(&k, p, n);
+    k *= m0;
+    k ^= k >> 32;
+    h = (h ^ k) * m1;
+    p += n;
+    size -= n;
+  }
+  h ^= h >> 31;
+  return h;
+}
+
+// Returns the offset of "size" bytes in the current frame slot of the ring
+// or UINT64_MAX on failure. Growing replaces the whole buffer, the old one is
+// retired and keeps serving draws which were already recorded from it.
+static uint64_t
+ImGui_ImplAC_RingAlloc(
+  ImGui_ImplACH_RingBuffer* ring,
+  uint64_t                  size,
+  ac_buffer_usage_bits      usage,
+  ac_memory_usage           memory_usage = ac_memory_usage_cpu_to_gpu)
 {
   ImGui_ImplAC_Data*           bd = ImGui_ImplAC_GetBackendData();
   ac_imgui_renderer_init_info* v = &bd->init_info;
-  ac_result                    err;
-  if (buffer)
+  uint64_t                     alignment = bd->buffer_memory_alignment;
+
+  if (ring->frame != bd->frame)
+  {
+    ring->frame = bd->frame;
+    ring->head = 0;
+  }
+
+  uint64_t head = ImGui_ImplAC_AlignUp(ring->head, alignment);
+
+  if (ring->buffer == NULL || head + size > ring->slot_size)
   {
-    ac_destroy_buffer(buffer);
-    buffer = NULL;
+    // Grow geometrically so a spike settles after a couple of reallocations
+    uint64_t slot_size = ring->slot_size * 2;
+    if (slot_size < head + size)
+    {
+      slot_size = head + size;
+    }
+    if (slot_size < MIN_RING_SLOT_SIZE)
+    {
+      slot_size = MIN_RING_SLOT_SIZE;
+    }
+    slot_size = ImGui_ImplAC_AlignUp(slot_size, alignment);
+
+    ac_buffer_info buffer_info = {};
+    buffer_info.size = slot_size * v->frame_count;
+    buffer_info.usage = usage;
+    buffer_info.name = "imgui ring buffer";
+    buffer_info.memory_usage = memory_usage;
+
+    ac_buffer buffer = NULL;
+    ac_result err = ac_create_buffer(v->device, &buffer_info, &buffer);
+    check_ac_result(err);
+    if (err != ac_result_success)
+    {
+      return UINT64_MAX;
+    }
+
+    if (memory_usage != ac_memory_usage_gpu_only)
+    {
+      err = ac_buffer_map_memory(buffer);
+      check_ac_result(err);
+      if (err != ac_result_success)
+      {
+        ac_destroy_buffer(buffer);
+        return UINT64_MAX;
+      }
+    }
+
+    if (ring->buffer)
+    {
+      bd->stats.buffer_resizes++;
+    }
+    ImGui_ImplAC_RetireRingBuffer(ring);
+
+    ring->buffer = buffer;
+    ring->mapped = memory_usage != ac_memory_usage_gpu_only
+                     ? (uint8_t*)ac_buffer_get_mapped_memory(buffer)
+                     : NULL;
+    ring->slot_size = slot_size;
+    head = 0;
   }
 
-  uint64_t vertex_buffer_size_aligned =
-    ((new_size - 1) / bd->buffer_memory_alignment + 1) *
-    bd->buffer_memory_alignment;
+  ring->head = head + size;
 
-  ac_buffer_info buffer_info = {};
-  buffer_info.size = vertex_buffer_size_aligned;
-  buffer_info.usage = usage;
-  buffer_info.name = "imgui buffer";
-  buffer_info.memory_usage = ac_memory_usage_cpu_to_gpu;
+  return bd->frame_index * ring->slot_size + head;
+}
 
-  err = ac_create_buffer(v->device, &buffer_info, &buffer);
-  check_ac_result(err);
+static ImTextureID
+ImGui_ImplAC_MakeStreamedTextureID(uint32_t index, uintptr_t generation)
+{
+  return (ImTextureID)(
+    STREAMED_TEXTURE_BIT | (generation << STREAMED_INDEX_BITS) | (index + 1));
+}
+
+static uint32_t
+ImGui_ImplAC_GetStreamedTextureIndex(uintptr_t id)
+{
+  return (uint32_t)(id & STREAMED_INDEX_MASK) - 1;
+}
+
+static uintptr_t
+ImGui_ImplAC_GetStreamedTextureGeneration(uintptr_t id)
+{
+  return (id >> STREAMED_INDEX_BITS) & STREAMED_GENERATION_MASK;
+}
+
+static uint32_t
+ImGui_ImplAC_GetTextureSet(const ImGui_ImplAC_Data* bd, const ImDrawCmd* pcmd)
+{
+  if (sizeof(ImTextureID) < sizeof(ImU64))
+  {
+    // We don't support texture switches if ImTextureID hasn't been
+    // redefined to be 64-bit. Do a flaky check that other textures
+    // haven't been used.
+    IM_ASSERT(pcmd->TextureId == (ImTextureID)(uintptr_t)bd->font_set);
+    return (uint32_t)(uintptr_t)bd->font_set - 1;
+  }
+  // Texture ids are slots offset by one to keep nullptr invalid, streamed
+  // textures resolve to the slot of their image or placeholder
+  uintptr_t id = (uintptr_t)pcmd->TextureId;
+  if (id & STREAMED_TEXTURE_BIT)
+  {
+    const ImGui_ImplACH_StreamedTexture& entry =
+      bd->streamed_textures[(int)ImGui_ImplAC_GetStreamedTextureIndex(id)];
+    bool valid =
+      entry.alive &&
+      ImGui_ImplAC_GetStreamedTextureGeneration(id) == entry.generation;
+    IM_ASSERT(valid && "Streamed texture used after being destroyed");
+    // The slot may already hold another texture, draw the font instead
+    if (!valid)
+    {
+      return (uint32_t)(uintptr_t)bd->font_set - 1;
+    }
+    id = (uintptr_t)(entry.texture ? entry.texture : entry.placeholder);
+  }
+  return (uint32_t)id - 1;
+}
+
+// Projects the clip rectangle of a command into framebuffer space, clamped to
+// the framebuffer. Returns false when nothing is left to draw.
+static bool
+ImGui_ImplAC_GetScissor(
+  ImDrawData*      draw_data,
+  const ImDrawCmd* pcmd,
+  int              fb_width,
+  int              fb_height,
+  int32_t          scissor[4])
+{
+  // Will project scissor/clipping rectangles into framebuffer space
+  ImVec2 clip_off = draw_data->DisplayPos; // (0,0) unless using multi-viewports
+  ImVec2 clip_scale =
+    draw_data->FramebufferScale; // (1,1) unless using retina display which are
+                                 // often (2,2)
+
+  // Project scissor/clipping rectangles into framebuffer space
+  ImVec2 clip_min(
+    (pcmd->ClipRect.x - clip_off.x) * clip_scale.x,
+    (pcmd->ClipRect.y - clip_off.y) * clip_scale.y);
+  ImVec2 clip_max(
+    (pcmd->ClipRect.z - clip_off.x) * clip_scale.x,
+    (pcmd->ClipRect.w - clip_off.y) * clip_scale.y);
+
+  // Clamp to viewport as vkCmdSetScissor() won't accept values that are
+  // off bounds
+  if (clip_min.x < 0.0f)
+  {
+    clip_min.x = 0.0f;
+  }
+  if (clip_min.y < 0.0f)
+  {
+    clip_min.y = 0.0f;
+  }
+  if (clip_max.x > fb_width)
+  {
+    clip_max.x = (float)fb_width;
+  }
+  if (clip_max.y > fb_height)
+  {
+    clip_max.y = (float)fb_height;
+  }
+  if (clip_max.x <= clip_min.x || clip_max.y <= clip_min.y)
+  {
+    return false;
+  }
+
+  scissor[0] = (int32_t)clip_min.x;
+  scissor[1] = (int32_t)clip_min.y;
+  scissor[2] = (int32_t)(clip_max.x - clip_min.x);
+  scissor[3] = (int32_t)(clip_max.y - clip_min.y);
+  return true;
+}
+
+// Formats whose writes encode to sRGB and whose reads decode to linear
+static bool
+ImGui_ImplAC_IsSRGBFormat(ac_format format)
+{
+  return format == ac_format_r8g8b8a8_srgb ||
+         format == ac_format_b8g8r8a8_srgb;
+}
+
+// Places the draw data at the target offset and clip rectangle of info, or
+// at the origin of the target without info, as for the unorm composite images
+static void
+ImGui_ImplAC_SetTarget(
+  ImGui_ImplACH_BoundState*            state,
+  const ac_imgui_renderer_render_info* info,
+  int                                  fb_width,
+  int                                  fb_height)
+{
+  state->linear_colors =
+    info && ImGui_ImplAC_IsSRGBFormat(info->target.color_format);
+  state->offset[0] = info ? info->target_offset[0] : 0;
+  state->offset[1] = info ? info->target_offset[1] : 0;
+  if (info && info->target_rect[2] > 0 && info->target_rect[3] > 0)
+  {
+    state->bounds[0] = info->target_rect[0];
+    state->bounds[1] = info->target_rect[1];
+    state->bounds[2] = info->target_rect[0] + info->target_rect[2];
+    state->bounds[3] = info->target_rect[1] + info->target_rect[3];
+  }
+  else
+  {
+    state->bounds[0] = state->offset[0];
+    state->bounds[1] = state->offset[1];
+    state->bounds[2] = state->offset[0] + fb_width;
+    state->bounds[3] = state->offset[1] + fb_height;
+  }
+}
+
+static void
+ImGui_ImplAC_InvalidateBoundState(ImGui_ImplACH_BoundState* state)
+{
+  state->list = -1;
+  state->page = UINT32_MAX;
+  state->texture = UINT32_MAX;
+  state->scissor[0] = -1;
+  state->scissor[1] = -1;
+  state->scissor[2] = -1;
+  state->scissor[3] = -1;
+  state->push_constants_valid = false;
 }
 
 static void
@@ -111,31 +886,55 @@ ImGui_ImplAC_SetupRenderState(
   ac_pipeline                       pipeline,
   ac_cmd                            command_buffer,
   ImGui_ImplACH_FrameRenderBuffers* rb,
+  ImGui_ImplACH_BoundState*         state,
   int                               fb_width,
   int                               fb_height)
 {
+  ImGui_ImplAC_InvalidateBoundState(state);
+
   // Bind pipeline:
   {
     ac_cmd_bind_pipeline(command_buffer, pipeline);
   }
 
   // Bind Vertex And Index Buffer:
-  if (draw_data->TotalVtxCount > 0)
+  // (cached draw lists are bound per list by ImGui_ImplAC_RecordDraws)
+  if (draw_data->TotalVtxCount > 0 && rb->vertex_buffer)
   {
-    ac_cmd_bind_vertex_buffer(command_buffer, 0, rb->vertex_buffer, 0);
+    ac_cmd_bind_vertex_buffer(
+      command_buffer,
+      0,
+      rb->vertex_buffer,
+      rb->vertex_offset);
     ac_cmd_bind_index_buffer(
       command_buffer,
       rb->index_buffer,
-      0,
+      rb->index_offset,
       sizeof(ImDrawIdx) == 2 ? ac_index_type_u16 : ac_index_type_u32);
+    if (rb->texture_buffer)
+    {
+      ac_cmd_bind_vertex_buffer(
+        command_buffer,
+        1,
+        rb->texture_buffer,
+        rb->texture_offset);
+    }
+    if (rb->clip_buffer)
+    {
+      ac_cmd_bind_vertex_buffer(
+        command_buffer,
+        2,
+        rb->clip_buffer,
+        rb->clip_offset);
+    }
   }
 
   // Setup viewport:
   {
     ac_cmd_set_viewport(
       command_buffer,
-      0,
-      0,
+      (float)state->offset[0],
+      (float)state->offset[1],
       (float)fb_width,
       (float)fb_height,
       0.0f,
@@ -143,267 +942,1972 @@ ImGui_ImplAC_SetupRenderState(
   }
 
   {
-    struct {
-      float scale[2];
-      float translate[2];
-    } pc;
+    ImGui_ImplACH_PushConstants& pc = state->push_constants;
 
-    float L = draw_data->DisplayPos.x;
-    float R = draw_data->DisplayPos.x + draw_data->DisplaySize.x;
-    float T = draw_data->DisplayPos.y;
-    float B = draw_data->DisplayPos.y + draw_data->DisplaySize.y;
+    // Packed positions are relative to the origin of the upload
+    float L = draw_data->DisplayPos.x - rb->pack_origin[0];
+    float R = L + draw_data->DisplaySize.x;
+    float T = draw_data->DisplayPos.y - rb->pack_origin[1];
+    float B = T + draw_data->DisplaySize.y;
 
     pc.scale[0] = 2.0f / (R - L);
     pc.scale[1] = 2.0f / (T - B);
     pc.translate[0] = (R + L) / (L - R);
     pc.translate[1] = (T + B) / (B - T);
+    pc.texture_kind = 0;
+    pc.clip_offset[0] = (float)state->offset[0];
+    pc.clip_offset[1] = (float)state->offset[1];
+    pc.shape_scale = draw_data->FramebufferScale.x;
+    pc.shape_texture = 0;
+    pc.linear_colors = state->linear_colors;
     ac_cmd_push_constants(command_buffer, sizeof(pc), &pc);
+    state->push_constants_valid = true;
   }
 }
 
-static ac_result
-ImGui_ImplAC_CreatePipeline(
-  ac_device    device,
-  uint32_t     samples,
-  ac_format    format,
-  ac_pipeline* pipeline);
-
-// Render function
-void
-ac_imgui_renderer_render_draw_data(
-  ImDrawData* draw_data,
-  ac_format   format,
-  ac_cmd      command_buffer)
+// Moves a scissor of the draw data into the target bounds, returns false
+// when nothing of it is left to draw
+static bool
+ImGui_ImplAC_SetScissor(
+  ac_cmd                    command_buffer,
+  ImGui_ImplACH_BoundState* state,
+  const int32_t             draw_scissor[4])
 {
-  // Avoid rendering when minimized, scale coordinates for retina displays
-  // (screen coordinates != framebuffer coordinates)
-  int fb_width =
-    (int)(draw_data->DisplaySize.x * draw_data->FramebufferScale.x);
-  int fb_height =
-    (int)(draw_data->DisplaySize.y * draw_data->FramebufferScale.y);
-  if (fb_width <= 0 || fb_height <= 0)
+  int32_t x0 = draw_scissor[0] + state->offset[0];
+  int32_t y0 = draw_scissor[1] + state->offset[1];
+  int32_t x1 = x0 + draw_scissor[2];
+  int32_t y1 = y0 + draw_scissor[3];
+  x0 = x0 > state->bounds[0] ? x0 : state->bounds[0];
+  y0 = y0 > state->bounds[1] ? y0 : state->bounds[1];
+  x1 = x1 < state->bounds[2] ? x1 : state->bounds[2];
+  y1 = y1 < state->bounds[3] ? y1 : state->bounds[3];
+  if (x1 <= x0 || y1 <= y0)
   {
-    return;
+    return false;
   }
 
-  ImGui_ImplAC_Data*           bd = ImGui_ImplAC_GetBackendData();
-  ac_imgui_renderer_init_info* v = &bd->init_info;
-
-  if (!bd->pipelines[0] || bd->pipeline_format != format)
+  int32_t scissor[4] = {x0, y0, x1 - x0, y1 - y0};
+  if (memcmp(scissor, state->scissor, sizeof(state->scissor)) != 0)
   {
-    if (bd->pipelines[1])
-    {
-      ac_destroy_pipeline(bd->pipelines[1]);
-      bd->pipelines[1] = nullptr;
-    }
-    bd->pipelines[1] = bd->pipelines[0];
-    ac_result res = ImGui_ImplAC_CreatePipeline(
-      v->device,
-      v->samples,
-      format,
-      &bd->pipelines[0]);
-    if (res != ac_result_success)
-    {
-      return;
-    }
-
-    bd->pipeline_format = format;
+    ac_cmd_set_scissor(
+      command_buffer,
+      scissor[0],
+      scissor[1],
+      (uint32_t)scissor[2],
+      (uint32_t)scissor[3]);
+    memcpy(state->scissor, scissor, sizeof(state->scissor));
+  }
+  else
+  {
+    state->stats->scissors_elided++;
   }
+  return true;
+}
 
-  ac_pipeline pipeline = bd->pipelines[0];
+// Binds DescriptorSet with font or user texture, with bindless textures the
+// whole array lives in the first set
+static void
+ImGui_ImplAC_BindSets(
+  ac_cmd                    command_buffer,
+  ImGui_ImplACH_BoundState* state,
+  uint32_t                  texture)
+{
+  ImGui_ImplAC_Data* bd = state->bd;
 
-  // Allocate array to store enough vertex/index buffers
-  ImGui_ImplACH_WindowRenderBuffers* wrb = &bd->MainWindowRenderBuffers;
-  if (wrb->FrameRenderBuffers == nullptr)
+  uint32_t page = 0;
+  uint32_t set = 0;
+  if (!bd->init_info.bindless_textures)
   {
-    wrb->Index = 0;
-    wrb->Count = v->frame_count;
-    wrb->FrameRenderBuffers = (ImGui_ImplACH_FrameRenderBuffers*)IM_ALLOC(
-      sizeof(ImGui_ImplACH_FrameRenderBuffers) * wrb->Count);
-    memset(
-      wrb->FrameRenderBuffers,
-      0,
-      sizeof(ImGui_ImplACH_FrameRenderBuffers) * wrb->Count);
+    page = texture / TEXTURE_PAGE_SIZE;
+    set = texture % TEXTURE_PAGE_SIZE;
   }
-  IM_ASSERT(wrb->Count == v->frame_count);
-  wrb->Index = (wrb->Index + 1) % wrb->Count;
-  ImGui_ImplACH_FrameRenderBuffers* rb = &wrb->FrameRenderBuffers[wrb->Index];
-
-  auto& frame = bd->sets[bd->MainWindowRenderBuffers.Index];
-  for (int32_t i = 0; i < frame.released_size; ++i)
+  else
   {
-    bd->stack[bd->stack_size] = frame.released[i];
-    bd->stack_size++;
+    texture = 0;
   }
-  frame.released_size = 0;
 
-  if (draw_data->TotalVtxCount > 0)
+  ac_descriptor_buffer db = bd->texture_pages[page];
+  if (state->page != page)
   {
-    // Create or resize the vertex/index buffers
-    size_t vertex_size = draw_data->TotalVtxCount * sizeof(ImDrawVert);
-    size_t index_size = draw_data->TotalIdxCount * sizeof(ImDrawIdx);
+    // Every page carries its own sampler set, both spaces have to come from
+    // the same descriptor buffer
+    ac_cmd_bind_set(command_buffer, db, ac_space0, 0);
+    state->page = page;
+    state->texture = UINT32_MAX;
+  }
+  else
+  {
+    state->stats->binds_elided++;
+  }
+  if (state->texture != texture)
+  {
+    ac_cmd_bind_set(command_buffer, db, ac_space1, set);
+    state->texture = texture;
+  }
+  else
+  {
+    state->stats->binds_elided++;
+  }
+
+  // Bindless shaders read the kind from the texture index bits instead
+  uint32_t texture_kind =
+    bd->init_info.bindless_textures ? 0 : bd->slot_kinds[texture];
+  uint32_t shape_texture =
+    !bd->init_info.bindless_textures &&
+    texture == (uint32_t)(uintptr_t)bd->font_set - 1;
+  if (
+    !state->push_constants_valid ||
+    state->push_constants.texture_kind != texture_kind ||
+    state->push_constants.shape_texture != shape_texture)
+  {
+    state->push_constants.texture_kind = texture_kind;
+    state->push_constants.shape_texture = shape_texture;
+    ac_cmd_push_constants(
+      command_buffer,
+      sizeof(state->push_constants),
+      &state->push_constants);
+    state->push_constants_valid = true;
+  }
+}
+
+static void
+ImGui_ImplAC_FlushDraw(
+  ac_cmd                     command_buffer,
+  ImGui_ImplACH_BoundState*  state,
+  ImGui_ImplACH_PendingDraw* draw)
+{
+  if (draw->index_count == 0)
+  {
+    return;
+  }
+
+  if (!ImGui_ImplAC_SetScissor(command_buffer, state, draw->scissor))
+  {
+    draw->index_count = 0;
+    return;
+  }
+  ImGui_ImplAC_BindSets(command_buffer, state, draw->texture);
+
+  // Draw
+  ac_cmd_draw_indexed(
+    command_buffer,
+    draw->index_count,
+    1,
+    draw->first_index,
+    draw->vertex_offset,
+    0);
+  state->stats->draw_calls++;
+
+  draw->index_count = 0;
+}
+
+// Draws the offscreen image of a composited draw list as one quad
+static void
+ImGui_ImplAC_DrawComposite(
+  ac_cmd                              command_buffer,
+  const ImGui_ImplACH_CompositeEntry* entry,
+  ImGui_ImplACH_BoundState*           state)
+{
+  ImGui_ImplAC_Data* bd = state->bd;
+
+  uint64_t vertex_size = 4 * sizeof(ImDrawVert);
+  uint64_t slot_size = ImGui_ImplAC_AlignUp(
+    vertex_size + 6 * sizeof(ImDrawIdx),
+    bd->buffer_memory_alignment);
+  uint64_t offset = bd->frame_index * slot_size;
+
+  ac_cmd_bind_pipeline(command_buffer, bd->composite_pipeline);
+  ac_cmd_bind_vertex_buffer(command_buffer, 0, entry->quad_buffer, offset);
+  ac_cmd_bind_index_buffer(
+    command_buffer,
+    entry->quad_buffer,
+    offset + vertex_size,
+    sizeof(ImDrawIdx) == 2 ? ac_index_type_u16 : ac_index_type_u32);
+
+  ImGui_ImplACH_PendingDraw draw = {};
+  draw.index_count = 6;
+  draw.texture = (uint32_t)(uintptr_t)entry->textures[entry->current] - 1;
+  memcpy(draw.scissor, entry->rect, sizeof(draw.scissor));
+  ImGui_ImplAC_FlushDraw(command_buffer, state, &draw);
+}
+
+// Records one draw call per run of commands which can share it
+static void
+ImGui_ImplAC_RecordDraws(
+  ImDrawData*                        draw_data,
+  ac_pipeline                        pipeline,
+  ac_cmd                             command_buffer,
+  ImGui_ImplACH_WindowRenderBuffers* wrb,
+  const ImGui_ImplACH_DrawRange&     range,
+  ImGui_ImplACH_BoundState*          state,
+  int                                fb_width,
+  int                                fb_height)
+{
+  ImGui_ImplAC_Data*                bd = state->bd;
+  ImGui_ImplACH_FrameRenderBuffers* rb = &wrb->upload;
+  const ImGui_ImplACH_ListRange*    list_ranges =
+    bd->init_info.cache_draw_lists ? wrb->list_ranges.Data : NULL;
+
+  // Render command lists
+  // (Because we merged all buffers into a single one, we maintain our own
+  // offset into them)
+  int                       global_vtx_offset = range.vtx_offset;
+  int                       global_idx_offset = range.idx_offset;
+  ImGui_ImplACH_PendingDraw draw = {};
+  bool list_scopes = bd->init_info.gpu_scope_fn != nullptr;
+  for (int n = range.first_list; n < range.first_list + range.list_count; n++)
+  {
+    const ImDrawList* cmd_list = draw_data->CmdLists[n];
+    const char*       list_name =
+      cmd_list->_OwnerName ? cmd_list->_OwnerName : "ImDrawList";
+    if (list_scopes)
+    {
+      // Draws can't be merged across scopes
+      ImGui_ImplAC_FlushDraw(command_buffer, state, &draw);
+      ImGui_ImplAC_GpuScope(bd, command_buffer, list_name, true);
+    }
+    if (n < wrb->list_composites.Size && wrb->list_composites[n] >= 0)
+    {
+      ImGui_ImplAC_FlushDraw(command_buffer, state, &draw);
+      ImGui_ImplAC_DrawComposite(
+        command_buffer,
+        &wrb->composites[wrb->list_composites[n]],
+        state);
+      ImGui_ImplAC_SetupRenderState(
+        draw_data,
+        pipeline,
+        command_buffer,
+        rb,
+        state,
+        fb_width,
+        fb_height);
+      if (!list_ranges)
+      {
+        global_idx_offset += cmd_list->IdxBuffer.Size;
+        global_vtx_offset += cmd_list->VtxBuffer.Size;
+      }
+      if (list_scopes)
+      {
+        ImGui_ImplAC_GpuScope(bd, command_buffer, list_name, false);
+      }
+      continue;
+    }
+    for (int cmd_i = 0; cmd_i < cmd_list->CmdBuffer.Size; cmd_i++)
+    {
+      const ImDrawCmd* pcmd = &cmd_list->CmdBuffer[cmd_i];
+      if (pcmd->UserCallback != nullptr)
+      {
+        ImGui_ImplAC_FlushDraw(command_buffer, state, &draw);
+
+        // User callback, registered via ImDrawList::AddCallback()
+        // (ImDrawCallback_ResetRenderState is a special callback value used by
+        // the user to request the renderer to reset render state.)
+        if (pcmd->UserCallback == ImDrawCallback_ResetRenderState)
+        {
+          ImGui_ImplAC_SetupRenderState(
+            draw_data,
+            pipeline,
+            command_buffer,
+            rb,
+            state,
+            fb_width,
+            fb_height);
+        }
+        else
+        {
+          pcmd->UserCallback(cmd_list, pcmd);
+          // The callback may have bound anything
+          ImGui_ImplAC_InvalidateBoundState(state);
+        }
+      }
+      else
+      {
+        int32_t scissor[4];
+        if (!ImGui_ImplAC_GetScissor(
+              draw_data,
+              pcmd,
+              fb_width,
+              fb_height,
+              scissor))
+        {
+          continue;
+        }
+        if (list_ranges && state->list != n)
+        {
+          // Cached lists live in their own buffers, offsets are list local
+          ImGui_ImplAC_FlushDraw(command_buffer, state, &draw);
+          ac_cmd_bind_vertex_buffer(
+            command_buffer,
+            0,
+            list_ranges[n].buffer,
+            list_ranges[n].vertex_offset);
+          ac_cmd_bind_index_buffer(
+            command_buffer,
+            list_ranges[n].buffer,
+            list_ranges[n].index_offset,
+            sizeof(ImDrawIdx) == 2 ? ac_index_type_u16 : ac_index_type_u32);
+          state->list = n;
+        }
+        uint32_t texture = ImGui_ImplAC_GetTextureSet(bd, pcmd);
+        uint32_t first_index = pcmd->IdxOffset + global_idx_offset;
+        int32_t  vertex_offset = pcmd->VtxOffset + global_vtx_offset;
+
+        // A command continuing the previous one extends its draw call. With
+        // bindless textures the texture comes from the vertex and may differ.
+        if (
+          draw.index_count > 0 &&
+          draw.first_index + draw.index_count == first_index &&
+          draw.vertex_offset == vertex_offset &&
+          (bd->init_info.bindless_textures || draw.texture == texture) &&
+          memcmp(draw.scissor, scissor, sizeof(scissor)) == 0)
+        {
+          draw.index_count += pcmd->ElemCount;
+          state->stats->draws_merged++;
+          continue;
+        }
+
+        ImGui_ImplAC_FlushDraw(command_buffer, state, &draw);
+
+        draw.index_count = pcmd->ElemCount;
+        draw.first_index = first_index;
+        draw.vertex_offset = vertex_offset;
+        draw.texture = texture;
+        memcpy(draw.scissor, scissor, sizeof(scissor));
+      }
+    }
+    if (!list_ranges)
+    {
+      global_idx_offset += cmd_list->IdxBuffer.Size;
+      global_vtx_offset += cmd_list->VtxBuffer.Size;
+    }
+    if (list_scopes)
+    {
+      ImGui_ImplAC_FlushDraw(command_buffer, state, &draw);
+      ImGui_ImplAC_GpuScope(bd, command_buffer, list_name, false);
+    }
+  }
+  ImGui_ImplAC_FlushDraw(command_buffer, state, &draw);
+}
+
+static ac_result
+ImGui_ImplAC_CreatePipeline(
+  ac_device    device,
+  uint32_t     samples,
+  ac_format    format,
+  bool         premultiplied,
+  bool         packed,
+  ac_pipeline* pipeline);
+
+// Returns the pipeline for key and vertex layout from the cache, creating it
+// on a miss. The least recently used pipeline is only destroyed once no frame
+// in flight can still use it.
+static ac_pipeline
+ImGui_ImplAC_GetPipeline(
+  const ac_imgui_renderer_pipeline_key& target,
+  bool                                  packed)
+{
+  ImGui_ImplAC_Data*           bd = ImGui_ImplAC_GetBackendData();
+  ac_imgui_renderer_init_info* v = &bd->init_info;
+
+  ac_imgui_renderer_pipeline_key key = target;
+  if (key.samples == 0)
+  {
+    key.samples = (v->samples != 0) ? v->samples : 1;
+  }
+
+  ImVector<ImGui_ImplACH_PipelineEntry>& pipelines = bd->pipelines;
+  for (int i = 0; i < pipelines.Size; i++)
+  {
+    ImGui_ImplACH_PipelineEntry& entry = pipelines[i];
+    if (
+      entry.key.color_format == key.color_format &&
+      entry.key.samples == key.samples &&
+      entry.key.blend_mode == key.blend_mode && entry.packed == packed)
+    {
+      ImGui_ImplACH_PipelineEntry hit = entry;
+      hit.used_frame = bd->frame;
+      memmove(pipelines.Data + 1, pipelines.Data, i * sizeof(hit));
+      pipelines[0] = hit;
+      return hit.pipeline;
+    }
+  }
+
+  ImGui_ImplACH_PipelineEntry entry = {};
+  entry.key = key;
+  entry.packed = packed;
+  entry.used_frame = bd->frame;
+  if (
+    ImGui_ImplAC_CreatePipeline(
+      v->device,
+      key.samples,
+      key.color_format,
+      key.blend_mode == ac_imgui_renderer_blend_mode_premultiplied,
+      packed,
+      &entry.pipeline) != ac_result_success)
+  {
+    return nullptr;
+  }
+  bd->stats.pipelines_created++;
+
+  if (
+    pipelines.Size >= MAX_CACHED_PIPELINES &&
+    bd->frame - pipelines.back().used_frame > v->frame_count)
+  {
+    ac_destroy_pipeline(pipelines.back().pipeline);
+    pipelines.pop_back();
+  }
+  pipelines.push_front(entry);
+
+  return entry.pipeline;
+}
+
+// Tags every vertex with the texture of the command drawing it. Built in
+// cached memory first as the scatter would be slow on write-combined memory.
+static void
+ImGui_ImplAC_WriteTextureIndices(ImDrawData* draw_data, uint32_t* dst)
+{
+  ImGui_ImplAC_Data* bd = ImGui_ImplAC_GetBackendData();
+  bd->texture_indices.resize(draw_data->TotalVtxCount);
+  uint32_t* indices = bd->texture_indices.Data;
+
+  for (int n = 0; n < draw_data->CmdListsCount; n++)
+  {
+    const ImDrawList* cmd_list = draw_data->CmdLists[n];
+    for (int cmd_i = 0; cmd_i < cmd_list->CmdBuffer.Size; cmd_i++)
+    {
+      const ImDrawCmd* pcmd = &cmd_list->CmdBuffer[cmd_i];
+      if (pcmd->UserCallback != nullptr)
+      {
+        continue;
+      }
+      uint32_t         texture = ImGui_ImplAC_GetTextureSet(bd, pcmd);
+      uint32_t*        base = indices + pcmd->VtxOffset;
+      if (bd->slot_kinds[texture] == TEXTURE_SDF)
+      {
+        texture |= TEXTURE_SDF_BIT;
+      }
+      else if (bd->slot_kinds[texture] == TEXTURE_ALPHA)
+      {
+        texture |= TEXTURE_ALPHA_BIT;
+      }
+      const ImDrawIdx* idx = cmd_list->IdxBuffer.Data + pcmd->IdxOffset;
+      for (uint32_t i = 0; i < pcmd->ElemCount; i++)
+      {
+        base[idx[i]] = texture;
+      }
+    }
+    indices += cmd_list->VtxBuffer.Size;
+  }
+
+  memcpy(
+    dst,
+    bd->texture_indices.Data,
+    draw_data->TotalVtxCount * sizeof(uint32_t));
+}
+
+// Builds the clip rectangles and arguments of every draw in one pass. Draws
+// are split into batches at user callbacks.
+static void
+ImGui_ImplAC_WriteIndirectDraws(
+  ImDrawData*                        draw_data,
+  ImGui_ImplACH_WindowRenderBuffers* wrb,
+  ImVec4*                            clip_dst,
+  ImGui_ImplACH_DrawIndexedIndirect* indirect_dst)
+{
+  ImGui_ImplAC_Data* bd = ImGui_ImplAC_GetBackendData();
+
+  int fb_width =
+    (int)(draw_data->DisplaySize.x * draw_data->FramebufferScale.x);
+  int fb_height =
+    (int)(draw_data->DisplaySize.y * draw_data->FramebufferScale.y);
+
+  ImVector<ImVec4>&                            clips = bd->indirect_clips;
+  ImVector<ImGui_ImplACH_DrawIndexedIndirect>& draws = bd->indirect_draws;
+  clips.resize(0);
+  draws.resize(0);
+  wrb->indirect_batches.resize(0);
+
+  ImGui_ImplACH_IndirectBatch batch = {};
+  int                         global_vtx_offset = 0;
+  int                         global_idx_offset = 0;
+  for (int n = 0; n < draw_data->CmdListsCount; n++)
+  {
+    const ImDrawList* cmd_list = draw_data->CmdLists[n];
+    for (int cmd_i = 0; cmd_i < cmd_list->CmdBuffer.Size; cmd_i++)
+    {
+      const ImDrawCmd* pcmd = &cmd_list->CmdBuffer[cmd_i];
+      if (pcmd->UserCallback != nullptr)
+      {
+        batch.draw_count = draws.Size - batch.first_draw;
+        batch.cmd_list = cmd_list;
+        batch.callback = pcmd;
+        wrb->indirect_batches.push_back(batch);
+        batch.first_draw = draws.Size;
+        continue;
+      }
+
+      int32_t scissor[4];
+      if (!ImGui_ImplAC_GetScissor(
+            draw_data,
+            pcmd,
+            fb_width,
+            fb_height,
+            scissor))
+      {
+        continue;
+      }
+      ImVec4 clip(
+        (float)scissor[0],
+        (float)scissor[1],
+        (float)(scissor[0] + scissor[2]),
+        (float)(scissor[1] + scissor[3]));
+      uint32_t first_index = pcmd->IdxOffset + global_idx_offset;
+      int32_t  vertex_offset = pcmd->VtxOffset + global_vtx_offset;
+
+      if (draws.Size > (int)batch.first_draw)
+      {
+        ImGui_ImplACH_DrawIndexedIndirect& last = draws.back();
+        const ImVec4&                      last_clip = clips.back();
+        if (
+          last.first_index + last.index_count == first_index &&
+          last.vertex_offset == vertex_offset && last_clip.x == clip.x &&
+          last_clip.y == clip.y && last_clip.z == clip.z &&
+          last_clip.w == clip.w)
+        {
+          last.index_count += pcmd->ElemCount;
+          bd->stats.draws_merged++;
+          continue;
+        }
+      }
+
+      // The draw index is passed as first instance to fetch its clip
+      // rectangle from the per instance vertex stream
+      ImGui_ImplACH_DrawIndexedIndirect draw = {};
+      draw.index_count = pcmd->ElemCount;
+      draw.instance_count = 1;
+      draw.first_index = first_index;
+      draw.vertex_offset = vertex_offset;
+      draw.first_instance = (uint32_t)draws.Size;
+      draws.push_back(draw);
+      clips.push_back(clip);
+    }
+    global_idx_offset += cmd_list->IdxBuffer.Size;
+    global_vtx_offset += cmd_list->VtxBuffer.Size;
+  }
+  batch.draw_count = draws.Size - batch.first_draw;
+  batch.cmd_list = nullptr;
+  batch.callback = nullptr;
+  wrb->indirect_batches.push_back(batch);
+
+  memcpy(clip_dst, clips.Data, clips.Size * sizeof(ImVec4));
+  memcpy(indirect_dst, draws.Data, draws.Size * sizeof(draws.Data[0]));
+}
+
+static void
+ImGui_ImplAC_RetireListCache(ImGui_ImplACH_WindowRenderBuffers* wrb)
+{
+  ImGui_ImplAC_Data* bd = ImGui_ImplAC_GetBackendData();
+  for (ImGui_ImplACH_ListCacheEntry& entry : wrb->list_cache)
+  {
+    ac_buffer_unmap_memory(entry.buffer);
+    ImGui_ImplAC_Garbage garbage = {};
+    garbage.buffer = entry.buffer;
+    garbage.frame = bd->frame;
+    bd->garbage.push_back(garbage);
+  }
+  wrb->list_cache.clear();
+  wrb->list_ranges.clear();
+}
+
+// Copies only the draw lists whose content hash changed since they were last
+// uploaded, the others keep using the copy already on the GPU
+static bool
+ImGui_ImplAC_UploadCachedDrawLists(
+  ImDrawData*                        draw_data,
+  ImGui_ImplACH_WindowRenderBuffers* wrb)
+{
+  ImGui_ImplAC_Data*           bd = ImGui_ImplAC_GetBackendData();
+  ac_imgui_renderer_init_info* v = &bd->init_info;
+  uint64_t                     alignment = bd->buffer_memory_alignment;
+
+  ImVector<ImGui_ImplACH_ListCacheEntry>& cache = wrb->list_cache;
+  wrb->list_ranges.resize(draw_data->CmdListsCount);
+  for (int n = 0; n < draw_data->CmdListsCount; n++)
+  {
+    const ImDrawList* cmd_list = draw_data->CmdLists[n];
+
+    // Lists usually come in the same order every frame, look there first
+    int i = n < cache.Size && cache[n].cmd_list == cmd_list ? n : 0;
+    for (; i < cache.Size && cache[i].cmd_list != cmd_list; i++)
+    {
+    }
+    if (i == cache.Size)
+    {
+      ImGui_ImplACH_ListCacheEntry entry = {};
+      entry.cmd_list = cmd_list;
+      cache.push_back(entry);
+    }
+    ImGui_ImplACH_ListCacheEntry& entry = cache[i];
+
+    size_t   vertex_size = cmd_list->VtxBuffer.size_in_bytes();
+    size_t   index_size = cmd_list->IdxBuffer.size_in_bytes();
+    uint64_t index_start = ImGui_ImplAC_AlignUp(vertex_size, alignment);
+    uint64_t hash =
+      ImGui_ImplAC_Hash(cmd_list->VtxBuffer.Data, vertex_size, vertex_size);
+    hash = ImGui_ImplAC_Hash(cmd_list->IdxBuffer.Data, index_size, hash);
+
+    entry.used_frame = bd->frame;
+    if (!entry.buffer || entry.hash != hash)
+    {
+      if (index_start + index_size > entry.slot_size)
+      {
+        uint64_t slot_size = entry.slot_size * 2;
+        if (slot_size < index_start + index_size)
+        {
+          slot_size = index_start + index_size;
+        }
+        if (slot_size < MIN_LIST_SLOT_SIZE)
+        {
+          slot_size = MIN_LIST_SLOT_SIZE;
+        }
+        slot_size = ImGui_ImplAC_AlignUp(slot_size, alignment);
+
+        ac_buffer_info buffer_info = {};
+        buffer_info.size = slot_size * v->frame_count;
+        buffer_info.usage =
+          ac_buffer_usage_vertex_bit | ac_buffer_usage_index_bit;
+        buffer_info.name = "imgui draw list cache";
+        buffer_info.memory_usage = ac_memory_usage_cpu_to_gpu;
+
+        ac_buffer buffer = NULL;
+        ac_result err = ac_create_buffer(v->device, &buffer_info, &buffer);
+        check_ac_result(err);
+        if (err == ac_result_success)
+        {
+          err = ac_buffer_map_memory(buffer);
+          check_ac_result(err);
+          if (err != ac_result_success)
+          {
+            ac_destroy_buffer(buffer);
+          }
+        }
+        if (err != ac_result_success)
+        {
+          return false;
+        }
+
+        if (entry.buffer)
+        {
+          bd->stats.buffer_resizes++;
+          ac_buffer_unmap_memory(entry.buffer);
+          ImGui_ImplAC_Garbage garbage = {};
+          garbage.buffer = entry.buffer;
+          garbage.frame = bd->frame;
+          bd->garbage.push_back(garbage);
+        }
+        entry.buffer = buffer;
+        entry.mapped = (uint8_t*)ac_buffer_get_mapped_memory(buffer);
+        entry.slot_size = slot_size;
+        entry.slot = 0;
+      }
+      else if (entry.written_frame != bd->frame)
+      {
+        // A second change within the same frame rewrites the slot in place,
+        // moving on twice would reach a slot the GPU may still read
+        entry.slot = (entry.slot + 1) % v->frame_count;
+      }
+
+      uint8_t* dst = entry.mapped + entry.slot * entry.slot_size;
+      ImGui_ImplAC_StreamCopy(dst, cmd_list->VtxBuffer.Data, vertex_size);
+      ImGui_ImplAC_StreamCopy(
+        dst + index_start,
+        cmd_list->IdxBuffer.Data,
+        index_size);
+      bd->stats.vertices_uploaded += cmd_list->VtxBuffer.Size;
+      bd->stats.indices_uploaded += cmd_list->IdxBuffer.Size;
+      bd->stats.bytes_written += vertex_size + index_size;
+      entry.hash = hash;
+      entry.written_frame = bd->frame;
+    }
+    else
+    {
+      bd->stats.draw_lists_reused++;
+    }
+
+    ImGui_ImplACH_ListRange& range = wrb->list_ranges[n];
+    range.buffer = entry.buffer;
+    range.vertex_offset = entry.slot * entry.slot_size;
+    range.index_offset = range.vertex_offset + index_start;
+  }
+  ImGui_ImplAC_StreamFence();
+
+  // Drop the copies of lists which stopped being drawn, e.g. closed windows
+  int32_t kept = 0;
+  for (int32_t i = 0; i < cache.Size; ++i)
+  {
+    ImGui_ImplACH_ListCacheEntry& entry = cache[i];
+    if (bd->frame - entry.used_frame > v->frame_count)
+    {
+      if (entry.buffer)
+      {
+        ac_buffer_unmap_memory(entry.buffer);
+        ImGui_ImplAC_Garbage garbage = {};
+        garbage.buffer = entry.buffer;
+        garbage.frame = bd->frame;
+        bd->garbage.push_back(garbage);
+      }
+    }
+    else
+    {
+      cache[kept++] = entry;
+    }
+  }
+  cache.resize(kept);
+
+  return true;
+}
+
+static void
+ImGui_ImplAC_CopyDrawListsJob(void* job_data, uint32_t job_index)
+{
+  ImGui_ImplACH_CopyJob& job = ((ImGui_ImplACH_CopyJob*)job_data)[job_index];
+  uint8_t*               vtx_dst = job.vtx_dst;
+  ImDrawIdx*             idx_dst = job.idx_dst;
+  for (int n = 0; n < job.list_count; n++)
+  {
+    const ImDrawList* cmd_list = job.cmd_lists[n];
     if (
-      rb->vertex_buffer == NULL ||
-      ac_buffer_get_size(rb->vertex_buffer) < vertex_size)
+      !ImGui_ImplAC_WriteVertices(
+        vtx_dst,
+        cmd_list->VtxBuffer.Data,
+        cmd_list->VtxBuffer.Size,
+        job.packed,
+        job.origin))
+    {
+      job.out_of_range = true;
+    }
+    ImGui_ImplAC_StreamCopy(
+      idx_dst,
+      cmd_list->IdxBuffer.Data,
+      cmd_list->IdxBuffer.size_in_bytes());
+    vtx_dst += cmd_list->VtxBuffer.Size * job.stride;
+    idx_dst += cmd_list->IdxBuffer.Size;
+  }
+  ImGui_ImplAC_StreamFence();
+}
+
+// Copies the geometry of all lists to the offsets given by the prefix sums of
+// their sizes, split into jobs for parallel_for_fn when there is enough of it.
+// Returns false when a vertex didn't fit the packed layout of rb.
+static bool
+ImGui_ImplAC_CopyDrawLists(
+  ImDrawData*                             draw_data,
+  const ImGui_ImplACH_FrameRenderBuffers* rb,
+  uint8_t*                                vtx_dst,
+  ImDrawIdx*                              idx_dst)
+{
+  ImGui_ImplAC_Data*           bd = ImGui_ImplAC_GetBackendData();
+  ac_imgui_renderer_init_info* v = &bd->init_info;
+
+  uint32_t stride = ImGui_ImplAC_GetVertexStride(rb->packed);
+  uint64_t total_size = (uint64_t)draw_data->TotalVtxCount * stride +
+                        draw_data->TotalIdxCount * sizeof(ImDrawIdx);
+  uint64_t job_count = total_size / MIN_COPY_JOB_SIZE;
+  if (job_count > (uint64_t)draw_data->CmdListsCount)
+  {
+    job_count = draw_data->CmdListsCount;
+  }
+  if (!v->parallel_for_fn || job_count < 2)
+  {
+    ImGui_ImplACH_CopyJob job = {};
+    job.cmd_lists = draw_data->CmdLists.Data;
+    job.list_count = draw_data->CmdListsCount;
+    job.vtx_dst = vtx_dst;
+    job.idx_dst = idx_dst;
+    job.stride = stride;
+    job.packed = rb->packed;
+    memcpy(job.origin, rb->pack_origin, sizeof(job.origin));
+    ImGui_ImplAC_CopyDrawListsJob(&job, 0);
+    return !job.out_of_range;
+  }
+
+  ImVector<ImGui_ImplACH_CopyJob>& jobs = bd->copy_jobs;
+  jobs.resize(0);
+  ImGui_ImplACH_CopyJob job = {};
+  job.cmd_lists = draw_data->CmdLists.Data;
+  job.vtx_dst = vtx_dst;
+  job.idx_dst = idx_dst;
+  job.stride = stride;
+  job.packed = rb->packed;
+  memcpy(job.origin, rb->pack_origin, sizeof(job.origin));
+  uint64_t offset = 0;
+  for (int n = 0; n < draw_data->CmdListsCount; n++)
+  {
+    const ImDrawList* cmd_list = draw_data->CmdLists[n];
+    job.list_count++;
+    vtx_dst += cmd_list->VtxBuffer.Size * stride;
+    idx_dst += cmd_list->IdxBuffer.Size;
+    offset += cmd_list->VtxBuffer.Size * stride +
+              cmd_list->IdxBuffer.size_in_bytes();
+
+    uint64_t target = total_size * (jobs.Size + 1) / job_count;
+    if (offset >= target || n == draw_data->CmdListsCount - 1)
+    {
+      jobs.push_back(job);
+      job.cmd_lists = draw_data->CmdLists.Data + n + 1;
+      job.list_count = 0;
+      job.vtx_dst = vtx_dst;
+      job.idx_dst = idx_dst;
+    }
+  }
+
+  v->parallel_for_fn(
+    (uint32_t)jobs.Size,
+    ImGui_ImplAC_CopyDrawListsJob,
+    jobs.Data,
+    v->parallel_for_user_data);
+
+  for (const ImGui_ImplACH_CopyJob& done : jobs)
+  {
+    if (done.out_of_range)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// ImGui::GetDrawData() returns the same pointer every frame, an upload of the
+// current renderer frame made during another ImGui frame means
+// ac_imgui_renderer_new_frame() was skipped and the upload is stale. The
+// batch buffers are shared by all contexts, whose frame counts differ, and
+// hold the lists of batch_draw_data which every batch upload gathers again.
+static void
+ImGui_ImplAC_CheckNewFrame(const ImGui_ImplACH_WindowRenderBuffers* wrb)
+{
+  ImGui_ImplAC_Data* bd = ImGui_ImplAC_GetBackendData();
+  IM_ASSERT(
+    (wrb == &bd->BatchRenderBuffers || wrb->upload_frame != bd->frame ||
+     wrb->upload_imgui_frame == ImGui::GetFrameCount()) &&
+    "Call ac_imgui_renderer_new_frame() every frame");
+  IM_UNUSED(bd);
+  IM_UNUSED(wrb);
+}
+
+// Packed vertices are relative to DisplayPos. Deferred copies run after the
+// caller picked its pipeline and always use ImDrawVert.
+static bool
+ImGui_ImplAC_WriteDrawData(
+  ImDrawData*                        draw_data,
+  ImGui_ImplACH_WindowRenderBuffers* wrb,
+  ac_cmd                             command_buffer,
+  bool                               defer_copies,
+  bool                               allow_packed = true)
+{
+  ImGui_ImplAC_Data*                bd = ImGui_ImplAC_GetBackendData();
+  ac_imgui_renderer_init_info*      v = &bd->init_info;
+  ImGui_ImplACH_FrameRenderBuffers* rb = &wrb->upload;
+
+  ImGui_ImplAC_CheckNewFrame(wrb);
+  memset(rb, 0, sizeof(*rb));
+  rb->packed = v->packed_vertices && allow_packed && !defer_copies;
+  if (rb->packed)
+  {
+    rb->pack_origin[0] = draw_data->DisplayPos.x;
+    rb->pack_origin[1] = draw_data->DisplayPos.y;
+  }
+  wrb->upload_draw_data = NULL;
+  wrb->list_composites.resize(0);
+
+  if (v->cache_draw_lists)
+  {
+    if (!ImGui_ImplAC_UploadCachedDrawLists(draw_data, wrb))
+    {
+      return false;
+    }
+  }
+  else if (draw_data->TotalVtxCount > 0)
+  {
+    uint32_t max_draws = 0;
+    if (v->indirect_draws)
+    {
+      for (int n = 0; n < draw_data->CmdListsCount; n++)
+      {
+        max_draws += draw_data->CmdLists[n]->CmdBuffer.Size;
+      }
+    }
+
+    size_t vertex_size =
+      draw_data->TotalVtxCount * ImGui_ImplAC_GetVertexStride(rb->packed);
+    size_t index_size = draw_data->TotalIdxCount * sizeof(ImDrawIdx);
+    size_t texture_size =
+      v->bindless_textures ? draw_data->TotalVtxCount * sizeof(uint32_t) : 0;
+    size_t clip_size = max_draws * sizeof(ImVec4);
+    size_t indirect_size =
+      max_draws * sizeof(ImGui_ImplACH_DrawIndexedIndirect);
+
+    // Byte offsets of every stream from the start of the vertices. Indices
+    // follow the vertices when both share a buffer, the per vertex texture
+    // indices and the indirect draw data come last.
+    bool     shared = v->device_local_draw_buffers || v->merge_draw_buffers;
+    uint64_t alignment = bd->buffer_memory_alignment;
+    uint64_t index_start = ImGui_ImplAC_AlignUp(vertex_size, alignment);
+    uint64_t texture_start = ImGui_ImplAC_AlignUp(
+      shared ? index_start + index_size : vertex_size,
+      alignment);
+    uint64_t clip_start =
+      ImGui_ImplAC_AlignUp(texture_start + texture_size, alignment);
+    uint64_t indirect_start =
+      ImGui_ImplAC_AlignUp(clip_start + clip_size, alignment);
+    uint64_t range_size = indirect_start + indirect_size;
+
+    uint32_t usage = ac_buffer_usage_vertex_bit;
+    if (shared)
+    {
+      usage |= ac_buffer_usage_index_bit;
+    }
+    if (v->indirect_draws)
+    {
+      usage |= ac_buffer_usage_indirect_bit;
+    }
+
+    uint64_t staging_offset = 0;
+    uint8_t* dst = nullptr;
+    ImDrawIdx* idx_dst = nullptr;
+
+    if (v->device_local_draw_buffers)
+    {
+      // Everything is staged in one range and copied as a whole into the
+      // same range of the gpu_only ring
+      staging_offset = ImGui_ImplAC_RingAlloc(
+        &wrb->vertex_ring,
+        range_size,
+        ac_buffer_usage_transfer_src_bit);
+      rb->vertex_offset = ImGui_ImplAC_RingAlloc(
+        &wrb->device_ring,
+        range_size,
+        (ac_buffer_usage_bits)(usage | ac_buffer_usage_transfer_dst_bit),
+        ac_memory_usage_gpu_only);
+      if (staging_offset == UINT64_MAX || rb->vertex_offset == UINT64_MAX)
+      {
+        return false;
+      }
+      rb->vertex_buffer = wrb->device_ring.buffer;
+      dst = wrb->vertex_ring.mapped + staging_offset;
+    }
+    else
+    {
+      rb->vertex_offset = ImGui_ImplAC_RingAlloc(
+        &wrb->vertex_ring,
+        range_size,
+        (ac_buffer_usage_bits)usage);
+      if (rb->vertex_offset == UINT64_MAX)
+      {
+        return false;
+      }
+      rb->vertex_buffer = wrb->vertex_ring.buffer;
+      dst = wrb->vertex_ring.mapped + rb->vertex_offset;
+    }
+
+    if (shared)
+    {
+      rb->index_buffer = rb->vertex_buffer;
+      rb->index_offset = rb->vertex_offset + index_start;
+      idx_dst = (ImDrawIdx*)(dst + index_start);
+    }
+    else
+    {
+      rb->index_offset = ImGui_ImplAC_RingAlloc(
+        &wrb->index_ring,
+        index_size,
+        ac_buffer_usage_index_bit);
+      if (rb->index_offset == UINT64_MAX)
+      {
+        return false;
+      }
+      rb->index_buffer = wrb->index_ring.buffer;
+      idx_dst = (ImDrawIdx*)(wrb->index_ring.mapped + rb->index_offset);
+    }
+
+    wrb->vertex_dst = dst;
+    wrb->index_dst = idx_dst;
+    if (
+      !defer_copies &&
+      !ImGui_ImplAC_CopyDrawLists(draw_data, rb, dst, idx_dst))
+    {
+      // A vertex didn't fit, upload ImDrawVert instead. The packed range
+      // stays unused until the ring wraps around.
+      bd->stats.packed_fallbacks++;
+      return ImGui_ImplAC_WriteDrawData(
+        draw_data,
+        wrb,
+        command_buffer,
+        defer_copies,
+        false);
+    }
+
+    if (v->bindless_textures)
+    {
+      rb->texture_buffer = rb->vertex_buffer;
+      rb->texture_offset = rb->vertex_offset + texture_start;
+      ImGui_ImplAC_WriteTextureIndices(
+        draw_data,
+        (uint32_t*)(dst + texture_start));
+    }
+
+    if (v->indirect_draws)
+    {
+      rb->clip_buffer = rb->vertex_buffer;
+      rb->clip_offset = rb->vertex_offset + clip_start;
+      rb->indirect_buffer = rb->vertex_buffer;
+      rb->indirect_offset = rb->vertex_offset + indirect_start;
+      ImGui_ImplAC_WriteIndirectDraws(
+        draw_data,
+        wrb,
+        (ImVec4*)(dst + clip_start),
+        (ImGui_ImplACH_DrawIndexedIndirect*)(dst + indirect_start));
+    }
+
+    bd->stats.vertices_uploaded += draw_data->TotalVtxCount;
+    bd->stats.indices_uploaded += draw_data->TotalIdxCount;
+    bd->stats.bytes_written += range_size;
+
+    if (v->device_local_draw_buffers)
+    {
+      ac_cmd_copy_buffer(
+        command_buffer,
+        wrb->vertex_ring.buffer,
+        staging_offset,
+        wrb->device_ring.buffer,
+        rb->vertex_offset,
+        range_size);
+      bd->stats.bytes_copied += range_size;
+
+      ac_buffer_barrier barrier[1] = {};
+      barrier[0].src_stage = ac_pipeline_stage_transfer_bit;
+      barrier[0].dst_stage = ac_pipeline_stage_vertex_input_bit;
+      barrier[0].src_access = ac_access_transfer_write_bit;
+      barrier[0].dst_access =
+        ac_access_vertex_attribute_read_bit | ac_access_index_read_bit;
+      if (v->indirect_draws)
+      {
+        barrier[0].dst_stage |= ac_pipeline_stage_draw_indirect_bit;
+        barrier[0].dst_access |= ac_access_indirect_command_read_bit;
+      }
+      barrier[0].buffer = wrb->device_ring.buffer;
+      barrier[0].offset = rb->vertex_offset;
+      barrier[0].size = range_size;
+
+      ac_cmd_barrier(command_buffer, 1, barrier, 0, NULL);
+    }
+  }
+
+  wrb->upload_draw_data = draw_data;
+  wrb->upload_frame = bd->frame;
+  wrb->upload_imgui_frame = ImGui::GetFrameCount();
+
+  return true;
+}
+
+// Marks the streamed textures drawn by the draw data with the largest extent
+// they cover on screen, and requests images for those missing or too small
+static void
+ImGui_ImplAC_UpdateStreamedTextures(ImDrawData* draw_data)
+{
+  ImGui_ImplAC_Data*           bd = ImGui_ImplAC_GetBackendData();
+  ac_imgui_renderer_init_info* v = &bd->init_info;
+  if (bd->streamed_textures.Size == bd->free_streamed_textures.Size)
+  {
+    return;
+  }
+
+  ImVector<uint32_t>& drawn = bd->drawn_streamed_textures;
+  drawn.resize(0);
+  for (int n = 0; n < draw_data->CmdListsCount; n++)
+  {
+    const ImDrawList* cmd_list = draw_data->CmdLists[n];
+    for (const ImDrawCmd& cmd : cmd_list->CmdBuffer)
+    {
+      uintptr_t id = (uintptr_t)cmd.TextureId;
+      if (cmd.UserCallback != nullptr || !(id & STREAMED_TEXTURE_BIT))
+      {
+        continue;
+      }
+      uint32_t index = ImGui_ImplAC_GetStreamedTextureIndex(id);
+      ImGui_ImplACH_StreamedTexture& entry = bd->streamed_textures[index];
+      // Destroyed after being drawn, the entry may belong to another texture
+      if (
+        !entry.alive ||
+        ImGui_ImplAC_GetStreamedTextureGeneration(id) != entry.generation)
+      {
+        continue;
+      }
+      if (entry.used_frame != bd->frame)
+      {
+        entry.used_frame = bd->frame;
+        entry.wanted_extent = 0;
+        drawn.push_back(index);
+      }
+
+      // Bounds of the command, textured quads only have a few vertices
+      ImVec2            min(FLT_MAX, FLT_MAX);
+      ImVec2            max(-FLT_MAX, -FLT_MAX);
+      const ImDrawIdx*  idx = cmd_list->IdxBuffer.Data + cmd.IdxOffset;
+      const ImDrawVert* vtx = cmd_list->VtxBuffer.Data + cmd.VtxOffset;
+      for (uint32_t i = 0; i < cmd.ElemCount; i++)
+      {
+        const ImVec2& pos = vtx[idx[i]].pos;
+        min.x = pos.x < min.x ? pos.x : min.x;
+        min.y = pos.y < min.y ? pos.y : min.y;
+        max.x = pos.x > max.x ? pos.x : max.x;
+        max.y = pos.y > max.y ? pos.y : max.y;
+      }
+      float    width = (max.x - min.x) * draw_data->FramebufferScale.x;
+      float    height = (max.y - min.y) * draw_data->FramebufferScale.y;
+      uint32_t extent = (uint32_t)(width > height ? width : height) + 1;
+      if (extent > entry.wanted_extent)
+      {
+        entry.wanted_extent = extent;
+      }
+    }
+  }
+
+  for (uint32_t index : drawn)
+  {
+    ImGui_ImplACH_StreamedTexture& entry = bd->streamed_textures[index];
+    if (
+      entry.wanted_extent > entry.extent &&
+      entry.wanted_extent > entry.requested_extent && v->texture_request_fn)
+    {
+      entry.requested_extent = entry.wanted_extent;
+      bd->stats.texture_requests++;
+      // May provide the image right away, which doesn't move the entries
+      v->texture_request_fn(
+        ImGui_ImplAC_MakeStreamedTextureID(index, entry.generation),
+        entry.user_key,
+        entry.wanted_extent,
+        v->texture_request_user_data);
+    }
+  }
+}
+
+// Releases the image of a streamed texture, the slot and image stay alive
+// for the frames in flight
+static void
+ImGui_ImplAC_EvictStreamedTexture(ImGui_ImplACH_StreamedTexture* entry)
+{
+  ImGui_ImplAC_Data* bd = ImGui_ImplAC_GetBackendData();
+  if (entry->texture)
+  {
+    ac_imgui_renderer_destroy_texture(entry->texture);
+    ImGui_ImplAC_Garbage garbage = {};
+    garbage.image = entry->image;
+    garbage.frame = bd->frame;
+    bd->garbage.push_back(garbage);
+    bd->streamed_texture_bytes -= entry->memory_size;
+  }
+  entry->texture = nullptr;
+  entry->image = nullptr;
+  entry->memory_size = 0;
+  entry->extent = 0;
+  entry->requested_extent = 0;
+}
+
+static int
+ImGui_ImplAC_CompareUsedFrame(const void* lhs, const void* rhs)
+{
+  ImGui_ImplAC_Data*                   bd = ImGui_ImplAC_GetBackendData();
+  const ImGui_ImplACH_StreamedTexture& a =
+    bd->streamed_textures[*(const uint32_t*)lhs];
+  const ImGui_ImplACH_StreamedTexture& b =
+    bd->streamed_textures[*(const uint32_t*)rhs];
+  return a.used_frame < b.used_frame ? -1 : a.used_frame > b.used_frame;
+}
+
+// Evicts the least recently drawn images until the budget is met. Images
+// drawn in the previous frame are kept as they are likely still visible.
+static void
+ImGui_ImplAC_EnforceTextureBudget()
+{
+  ImGui_ImplAC_Data*           bd = ImGui_ImplAC_GetBackendData();
+  ac_imgui_renderer_init_info* v = &bd->init_info;
+  if (v->texture_budget == 0 || bd->streamed_texture_bytes <= v->texture_budget)
+  {
+    return;
+  }
+
+  ImVector<uint32_t> candidates;
+  for (int i = 0; i < bd->streamed_textures.Size; i++)
+  {
+    const ImGui_ImplACH_StreamedTexture& entry = bd->streamed_textures[i];
+    if (entry.texture && entry.used_frame + 1 < bd->frame)
+    {
+      candidates.push_back((uint32_t)i);
+    }
+  }
+  qsort(
+    candidates.Data,
+    candidates.Size,
+    sizeof(uint32_t),
+    ImGui_ImplAC_CompareUsedFrame);
+
+  for (uint32_t index : candidates)
+  {
+    if (bd->streamed_texture_bytes <= v->texture_budget)
+    {
+      break;
+    }
+    ImGui_ImplAC_EvictStreamedTexture(&bd->streamed_textures[index]);
+    bd->stats.texture_evictions++;
+  }
+}
+
+// Allocates and fills the ranges of the draw data. With defer_copies the
+// vertices and indices are left to ac_imgui_renderer_record_draw_range().
+static bool
+ImGui_ImplAC_UploadDrawData(
+  ImDrawData*                        draw_data,
+  ImGui_ImplACH_WindowRenderBuffers* wrb,
+  ac_cmd                             command_buffer,
+  bool                               defer_copies = false)
+{
+  ImGui_ImplAC_Data* bd = ImGui_ImplAC_GetBackendData();
+  uint64_t           start = ImGui_ImplAC_GetMicroseconds();
+  ImGui_ImplAC_UpdateStreamedTextures(draw_data);
+  bool result =
+    ImGui_ImplAC_WriteDrawData(draw_data, wrb, command_buffer, defer_copies);
+  ImGui_ImplAC_AddElapsed(&bd->stats.upload_cpu_ms, start);
+  return result;
+}
+
+// Frees the slot once the frames in flight retire. Unlike
+// ac_imgui_renderer_destroy_texture() it leaves texture_generation alone, for
+// slots no draw data refers to.
+static void
+ImGui_ImplAC_ReleaseTexture(ImTextureID texture)
+{
+  ImGui_ImplAC_Data* bd = ImGui_ImplAC_GetBackendData();
+  bd->released_slots[bd->frame_index].push_back(
+    (uint32_t)(uintptr_t)texture - 1);
+}
+
+static void
+ImGui_ImplAC_RetireCompositeImages(ImGui_ImplACH_CompositeEntry* entry)
+{
+  ImGui_ImplAC_Data* bd = ImGui_ImplAC_GetBackendData();
+  for (uint32_t i = 0; i < AC_MAX_FRAME_IN_FLIGHT; ++i)
+  {
+    if (entry->images[i])
+    {
+      ImGui_ImplAC_ReleaseTexture(entry->textures[i]);
+      ImGui_ImplAC_Garbage garbage = {};
+      garbage.image = entry->images[i];
+      garbage.frame = bd->frame;
+      bd->garbage.push_back(garbage);
+    }
+    entry->images[i] = NULL;
+    entry->textures[i] = NULL;
+  }
+}
+
+static void
+ImGui_ImplAC_RetireComposite(ImGui_ImplACH_CompositeEntry* entry)
+{
+  ImGui_ImplAC_Data* bd = ImGui_ImplAC_GetBackendData();
+  ImGui_ImplAC_RetireCompositeImages(entry);
+  if (entry->quad_buffer)
+  {
+    ac_buffer_unmap_memory(entry->quad_buffer);
+    ImGui_ImplAC_Garbage garbage = {};
+    garbage.buffer = entry->quad_buffer;
+    garbage.frame = bd->frame;
+    bd->garbage.push_back(garbage);
+    entry->quad_buffer = NULL;
+    entry->quad_mapped = NULL;
+  }
+}
+
+// Renders the draw list of a composite entry into its current image
+static void
+ImGui_ImplAC_RenderCompositeImage(
+  ImDrawData*                        draw_data,
+  ImGui_ImplACH_WindowRenderBuffers* wrb,
+  ac_cmd                             command_buffer,
+  ac_pipeline                        pipeline,
+  int                                list,
+  int                                vtx_offset,
+  int                                idx_offset,
+  ImGui_ImplACH_CompositeEntry*      entry)
+{
+  ImGui_ImplAC_Data* bd = ImGui_ImplAC_GetBackendData();
+  const ImDrawList*  cmd_list = draw_data->CmdLists[list];
+  ac_image           image = entry->images[entry->current];
+  int                width = entry->rect[2];
+  int                height = entry->rect[3];
+
+  ac_image_barrier write_barrier[1] = {};
+  write_barrier[0].src_stage = ac_pipeline_stage_pixel_shader_bit;
+  write_barrier[0].dst_stage = ac_pipeline_stage_color_attachment_output_bit;
+  write_barrier[0].src_access = ac_access_shader_read_bit;
+  write_barrier[0].dst_access = ac_access_color_attachment_write_bit;
+  write_barrier[0].old_layout = ac_image_layout_undefined;
+  write_barrier[0].new_layout = ac_image_layout_color_write;
+  write_barrier[0].image = image;
+  write_barrier[0].range.layers = 1;
+  write_barrier[0].range.levels = 1;
+
+  ac_cmd_barrier(command_buffer, 0, NULL, 1, write_barrier);
+
+  // Cleared to transparent black, the regular blending then leaves
+  // premultiplied colors in the image
+  ac_rendering_info rendering_info = {};
+  rendering_info.color_attachment_count = 1;
+  rendering_info.color_attachments[0].image = image;
+  rendering_info.color_attachments[0].load_op = ac_attachment_load_op_clear;
+  rendering_info.color_attachments[0].store_op = ac_attachment_store_op_store;
+  ac_cmd_begin_rendering(command_buffer, &rendering_info);
+
+  // Same projection as the main pass, shifted to the corner of the image
+  ImDrawData offscreen;
+  offscreen.TotalVtxCount = draw_data->TotalVtxCount;
+  offscreen.FramebufferScale = draw_data->FramebufferScale;
+  offscreen.DisplayPos = ImVec2(
+    draw_data->DisplayPos.x + entry->rect[0] / draw_data->FramebufferScale.x,
+    draw_data->DisplayPos.y + entry->rect[1] / draw_data->FramebufferScale.y);
+  offscreen.DisplaySize = ImVec2(
+    width / draw_data->FramebufferScale.x,
+    height / draw_data->FramebufferScale.y);
+
+  ImGui_ImplACH_BoundState state;
+  state.bd = bd;
+  state.stats = &bd->stats;
+  ImGui_ImplAC_SetTarget(&state, nullptr, width, height);
+  ImGui_ImplAC_SetupRenderState(
+    &offscreen,
+    pipeline,
+    command_buffer,
+    &wrb->upload,
+    &state,
+    width,
+    height);
+
+  if (bd->init_info.cache_draw_lists)
+  {
+    const ImGui_ImplACH_ListRange& range = wrb->list_ranges[list];
+    ac_cmd_bind_vertex_buffer(
+      command_buffer,
+      0,
+      range.buffer,
+      range.vertex_offset);
+    ac_cmd_bind_index_buffer(
+      command_buffer,
+      range.buffer,
+      range.index_offset,
+      sizeof(ImDrawIdx) == 2 ? ac_index_type_u16 : ac_index_type_u32);
+    vtx_offset = 0;
+    idx_offset = 0;
+  }
+
+  for (const ImDrawCmd& cmd : cmd_list->CmdBuffer)
+  {
+    ImGui_ImplACH_PendingDraw draw = {};
+    if (!ImGui_ImplAC_GetScissor(
+          &offscreen,
+          &cmd,
+          width,
+          height,
+          draw.scissor))
+    {
+      continue;
+    }
+    draw.index_count = cmd.ElemCount;
+    draw.first_index = cmd.IdxOffset + idx_offset;
+    draw.vertex_offset = cmd.VtxOffset + vtx_offset;
+    draw.texture = ImGui_ImplAC_GetTextureSet(bd, &cmd);
+    ImGui_ImplAC_FlushDraw(command_buffer, &state, &draw);
+  }
+
+  ac_cmd_end_rendering(command_buffer);
+
+  ac_image_barrier read_barrier[1] = {};
+  read_barrier[0].src_stage = ac_pipeline_stage_color_attachment_output_bit;
+  read_barrier[0].dst_stage = ac_pipeline_stage_pixel_shader_bit;
+  read_barrier[0].src_access = ac_access_color_attachment_write_bit;
+  read_barrier[0].dst_access = ac_access_shader_read_bit;
+  read_barrier[0].old_layout = ac_image_layout_color_write;
+  read_barrier[0].new_layout = ac_image_layout_shader_read;
+  read_barrier[0].image = image;
+  read_barrier[0].range.layers = 1;
+  read_barrier[0].range.levels = 1;
+
+  ac_cmd_barrier(command_buffer, 0, NULL, 1, read_barrier);
+}
+
+static ImTextureID
+ImGui_ImplAC_CreateTexture(ac_image image, uint8_t kind);
+
+// Re-renders the offscreen image of every requested draw list whose content
+// changed and writes the quads replacing them in the main pass
+static void
+ImGui_ImplAC_UpdateComposites(
+  ImDrawData*                        draw_data,
+  ImGui_ImplACH_WindowRenderBuffers* wrb,
+  ac_cmd                             command_buffer)
+{
+  ImGui_ImplAC_Data*           bd = ImGui_ImplAC_GetBackendData();
+  ac_imgui_renderer_init_info* v = &bd->init_info;
+
+  ImVector<ImGui_ImplACH_CompositeEntry>& composites = wrb->composites;
+
+  // Drop the entries of lists which are no longer composited
+  int32_t kept = 0;
+  for (int32_t i = 0; i < composites.Size; ++i)
+  {
+    if (bd->frame - composites[i].used_frame > v->frame_count)
+    {
+      ImGui_ImplAC_RetireComposite(&composites[i]);
+    }
+    else
+    {
+      composites[kept++] = composites[i];
+    }
+  }
+  composites.resize(kept);
+
+  if (bd->composite_requests.empty())
+  {
+    return;
+  }
+
+  ac_imgui_renderer_pipeline_key key = {};
+  key.color_format = COMPOSITE_FORMAT;
+  key.samples = 1;
+  ac_pipeline pipeline = ImGui_ImplAC_GetPipeline(key, wrb->upload.packed);
+  if (!pipeline)
+  {
+    return;
+  }
+
+  int fb_width =
+    (int)(draw_data->DisplaySize.x * draw_data->FramebufferScale.x);
+  int fb_height =
+    (int)(draw_data->DisplaySize.y * draw_data->FramebufferScale.y);
+
+  wrb->list_composites.resize(draw_data->CmdListsCount, -1);
+
+  int global_vtx_offset = 0;
+  int global_idx_offset = 0;
+  for (int n = 0; n < draw_data->CmdListsCount; n++)
+  {
+    const ImDrawList* cmd_list = draw_data->CmdLists[n];
+    int               vtx_offset = global_vtx_offset;
+    int               idx_offset = global_idx_offset;
+    global_vtx_offset += cmd_list->VtxBuffer.Size;
+    global_idx_offset += cmd_list->IdxBuffer.Size;
+
+    if (!bd->composite_requests.contains(cmd_list))
+    {
+      continue;
+    }
+
+    // Bounds of the list in framebuffer space. What user callbacks draw
+    // can't be captured.
+    ImVec2 clip_min(FLT_MAX, FLT_MAX);
+    ImVec2 clip_max(-FLT_MAX, -FLT_MAX);
+    bool   has_callbacks = false;
+    for (const ImDrawCmd& cmd : cmd_list->CmdBuffer)
+    {
+      has_callbacks |= cmd.UserCallback != nullptr;
+      clip_min.x = cmd.ClipRect.x < clip_min.x ? cmd.ClipRect.x : clip_min.x;
+      clip_min.y = cmd.ClipRect.y < clip_min.y ? cmd.ClipRect.y : clip_min.y;
+      clip_max.x = cmd.ClipRect.z > clip_max.x ? cmd.ClipRect.z : clip_max.x;
+      clip_max.y = cmd.ClipRect.w > clip_max.y ? cmd.ClipRect.w : clip_max.y;
+    }
+    if (has_callbacks)
+    {
+      continue;
+    }
+
+    ImDrawCmd bounds;
+    bounds.ClipRect = ImVec4(clip_min.x, clip_min.y, clip_max.x, clip_max.y);
+    int32_t rect[4];
+    if (!ImGui_ImplAC_GetScissor(draw_data, &bounds, fb_width, fb_height, rect))
+    {
+      continue;
+    }
+
+    int i = 0;
+    for (; i < composites.Size && composites[i].cmd_list != cmd_list; i++)
+    {
+    }
+    if (i == composites.Size)
+    {
+      ImGui_ImplACH_CompositeEntry entry = {};
+      entry.cmd_list = cmd_list;
+      composites.push_back(entry);
+    }
+    ImGui_ImplACH_CompositeEntry& entry = composites[i];
+    entry.used_frame = bd->frame;
+
+    uint64_t hash = ImGui_ImplAC_Hash(rect, sizeof(rect), 0);
+    hash = ImGui_ImplAC_Hash(
+      &bd->texture_generation,
+      sizeof(bd->texture_generation),
+      hash);
+    hash = ImGui_ImplAC_Hash(
+      cmd_list->CmdBuffer.Data,
+      cmd_list->CmdBuffer.size_in_bytes(),
+      hash);
+    hash = ImGui_ImplAC_Hash(
+      cmd_list->VtxBuffer.Data,
+      cmd_list->VtxBuffer.size_in_bytes(),
+      hash);
+    hash = ImGui_ImplAC_Hash(
+      cmd_list->IdxBuffer.Data,
+      cmd_list->IdxBuffer.size_in_bytes(),
+      hash);
+
+    // Quads are ImDrawVert relative to the origin of the upload
+    uint64_t quad_vertex_size = 4 * sizeof(ImDrawVert);
+    uint64_t quad_slot_size = ImGui_ImplAC_AlignUp(
+      quad_vertex_size + 6 * sizeof(ImDrawIdx),
+      bd->buffer_memory_alignment);
+    if (!entry.quad_buffer)
+    {
+      ac_buffer_info buffer_info = {};
+      buffer_info.size = quad_slot_size * v->frame_count;
+      buffer_info.usage =
+        ac_buffer_usage_vertex_bit | ac_buffer_usage_index_bit;
+      buffer_info.name = "imgui composite quad";
+      buffer_info.memory_usage = ac_memory_usage_cpu_to_gpu;
+
+      ac_result err =
+        ac_create_buffer(v->device, &buffer_info, &entry.quad_buffer);
+      check_ac_result(err);
+      if (err != ac_result_success)
+      {
+        continue;
+      }
+      err = ac_buffer_map_memory(entry.quad_buffer);
+      check_ac_result(err);
+      if (err != ac_result_success)
+      {
+        ac_destroy_buffer(entry.quad_buffer);
+        entry.quad_buffer = NULL;
+        continue;
+      }
+      entry.quad_mapped =
+        (uint8_t*)ac_buffer_get_mapped_memory(entry.quad_buffer);
+    }
+
+    if (entry.hash != hash || !entry.images[entry.current])
+    {
+      if (
+        (uint32_t)rect[2] > entry.image_width ||
+        (uint32_t)rect[3] > entry.image_height)
+      {
+        ImGui_ImplAC_RetireCompositeImages(&entry);
+        entry.image_width = (uint32_t)ImGui_ImplAC_AlignUp(
+          rect[2],
+          COMPOSITE_SIZE_ALIGNMENT);
+        entry.image_height = (uint32_t)ImGui_ImplAC_AlignUp(
+          rect[3],
+          COMPOSITE_SIZE_ALIGNMENT);
+        entry.current = 0;
+      }
+      else if (entry.written_frame != bd->frame)
+      {
+        // Same rotation as the list cache, the image drawn frame_count frames
+        // ago is free again
+        entry.current = (entry.current + 1) % v->frame_count;
+      }
+
+      if (!entry.images[entry.current])
+      {
+        ac_image_info info = {};
+        info.type = ac_image_type_2d;
+        info.format = COMPOSITE_FORMAT;
+        info.width = entry.image_width;
+        info.height = entry.image_height;
+        info.layers = 1;
+        info.samples = 1;
+        info.levels = 1;
+        info.usage = ac_image_usage_srv_bit | ac_image_usage_attachment_bit;
+        info.name = "imgui composite";
+
+        ac_image  image = NULL;
+        ac_result err = ac_create_image(v->device, &info, &image);
+        check_ac_result(err);
+        if (err != ac_result_success)
+        {
+          continue;
+        }
+        ImTextureID texture =
+          ImGui_ImplAC_CreateTexture(image, TEXTURE_COMPOSITE);
+        if (!texture)
+        {
+          ac_destroy_image(image);
+          continue;
+        }
+        entry.images[entry.current] = image;
+        entry.textures[entry.current] = texture;
+      }
+
+      memcpy(entry.rect, rect, sizeof(rect));
+      ImGui_ImplAC_RenderCompositeImage(
+        draw_data,
+        wrb,
+        command_buffer,
+        pipeline,
+        n,
+        vtx_offset,
+        idx_offset,
+        &entry);
+      entry.hash = hash;
+      entry.written_frame = bd->frame;
+      bd->stats.composites_rendered++;
+    }
+
+    // The quad of this frame, in display coordinates
+    const float* origin = wrb->upload.pack_origin;
+    ImVec2       scale = draw_data->FramebufferScale;
+    ImVec2       p0(
+      draw_data->DisplayPos.x - origin[0] + rect[0] / scale.x,
+      draw_data->DisplayPos.y - origin[1] + rect[1] / scale.y);
+    ImVec2 p1(
+      p0.x + rect[2] / scale.x,
+      p0.y + rect[3] / scale.y);
+    ImVec2 uv1(
+      (float)rect[2] / entry.image_width,
+      (float)rect[3] / entry.image_height);
+
+    uint8_t*   slot = entry.quad_mapped + bd->frame_index * quad_slot_size;
+    ImDrawVert vertices[4] = {
+      {ImVec2(p0.x, p0.y), ImVec2(0, 0), IM_COL32_WHITE},
+      {ImVec2(p1.x, p0.y), ImVec2(uv1.x, 0), IM_COL32_WHITE},
+      {ImVec2(p1.x, p1.y), ImVec2(uv1.x, uv1.y), IM_COL32_WHITE},
+      {ImVec2(p0.x, p1.y), ImVec2(0, uv1.y), IM_COL32_WHITE},
+    };
+    ImGui_ImplAC_StreamCopy(slot, vertices, sizeof(vertices));
+    ImDrawIdx indices[6] = {0, 1, 2, 0, 2, 3};
+    memcpy(slot + quad_vertex_size, indices, sizeof(indices));
+
+    wrb->list_composites[n] = i;
+    bd->stats.composites_drawn++;
+  }
+  ImGui_ImplAC_StreamFence();
+}
+
+void
+ac_imgui_renderer_upload_draw_data(ImDrawData* draw_data, ac_cmd command_buffer)
+{
+  int fb_width =
+    (int)(draw_data->DisplaySize.x * draw_data->FramebufferScale.x);
+  int fb_height =
+    (int)(draw_data->DisplaySize.y * draw_data->FramebufferScale.y);
+  if (fb_width <= 0 || fb_height <= 0)
+  {
+    return;
+  }
+
+  ImGui_ImplACH_WindowRenderBuffers* wrb =
+    ImGui_ImplAC_GetWindowRenderBuffers(draw_data);
+  if (ImGui_ImplAC_UploadDrawData(draw_data, wrb, command_buffer))
+  {
+    ImGui_ImplAC_UpdateComposites(draw_data, wrb, command_buffer);
+  }
+}
+
+IMGUI_IMPL_API uint32_t
+ac_imgui_renderer_begin_draw_ranges(
+  ImDrawData*                          draw_data,
+  const ac_imgui_renderer_render_info* info,
+  uint32_t                             range_count,
+  ac_imgui_renderer_draw_range*        ranges,
+  ac_cmd                               command_buffer)
+{
+  ImGui_ImplAC_Data*           bd = ImGui_ImplAC_GetBackendData();
+  ac_imgui_renderer_init_info* v = &bd->init_info;
+  IM_ASSERT(
+    !v->indirect_draws && !v->cache_draw_lists &&
+    "Draw ranges need the direct draw path with one upload");
+  IM_ASSERT(
+    (command_buffer || !v->device_local_draw_buffers) &&
+    "device_local_draw_buffers records its copy into command_buffer");
+
+  ImGui_ImplACH_WindowRenderBuffers* wrb =
+    ImGui_ImplAC_GetWindowRenderBuffers(draw_data);
+  wrb->draw_ranges.resize(0);
+
+  // Deferred copies upload ImDrawVert
+  wrb->range_pipeline = ImGui_ImplAC_GetPipeline(info->target, false);
+  wrb->range_info = *info;
+
+  int fb_width =
+    (int)(draw_data->DisplaySize.x * draw_data->FramebufferScale.x);
+  int fb_height =
+    (int)(draw_data->DisplaySize.y * draw_data->FramebufferScale.y);
+  if (
+    fb_width <= 0 || fb_height <= 0 || range_count == 0 ||
+    !wrb->range_pipeline ||
+    !ImGui_ImplAC_UploadDrawData(draw_data, wrb, command_buffer, true))
+  {
+    return 0;
+  }
+
+  // Split the lists into ranges of about the same index count, the offsets
+  // of every range are the prefix sums of the lists before it
+  ImGui_ImplACH_DrawRange range = {};
+  range.bd = bd;
+  range.wrb = wrb;
+  range.draw_data = draw_data;
+  int vtx_offset = 0;
+  int idx_offset = 0;
+  for (int n = 0; n < draw_data->CmdListsCount; n++)
+  {
+    const ImDrawList* cmd_list = draw_data->CmdLists[n];
+    range.list_count++;
+    vtx_offset += cmd_list->VtxBuffer.Size;
+    idx_offset += cmd_list->IdxBuffer.Size;
+
+    uint64_t target = (uint64_t)draw_data->TotalIdxCount *
+                      (wrb->draw_ranges.Size + 1) / range_count;
+    if ((uint64_t)idx_offset >= target || n == draw_data->CmdListsCount - 1)
+    {
+      wrb->draw_ranges.push_back(range);
+      range.first_list = n + 1;
+      range.list_count = 0;
+      range.vtx_offset = vtx_offset;
+      range.idx_offset = idx_offset;
+    }
+  }
+
+  // Every range was pushed, the vector no longer moves
+  for (int i = 0; i < wrb->draw_ranges.Size; i++)
+  {
+    ranges[i] = &wrb->draw_ranges[i];
+  }
+  return (uint32_t)wrb->draw_ranges.Size;
+}
+
+IMGUI_IMPL_API void
+ac_imgui_renderer_record_draw_range(
+  ac_imgui_renderer_draw_range draw_range,
+  ac_cmd                       command_buffer)
+{
+  ImGui_ImplACH_DrawRange&           range = *draw_range;
+  ImGui_ImplAC_Data*                 bd = range.bd;
+  ImGui_ImplACH_WindowRenderBuffers* wrb = range.wrb;
+  ImDrawData*                        draw_data = range.draw_data;
+
+  // Copy the geometry of the range into the slots reserved for it
+  ImGui_ImplACH_CopyJob job = {};
+  job.cmd_lists = draw_data->CmdLists.Data + range.first_list;
+  job.list_count = range.list_count;
+  job.stride = ImGui_ImplAC_GetVertexStride(wrb->upload.packed);
+  job.packed = wrb->upload.packed;
+  memcpy(job.origin, wrb->upload.pack_origin, sizeof(job.origin));
+  job.vtx_dst = wrb->vertex_dst + (size_t)range.vtx_offset * job.stride;
+  job.idx_dst = wrb->index_dst + range.idx_offset;
+  ImGui_ImplAC_CopyDrawListsJob(&job, 0);
+
+  int fb_width =
+    (int)(draw_data->DisplaySize.x * draw_data->FramebufferScale.x);
+  int fb_height =
+    (int)(draw_data->DisplaySize.y * draw_data->FramebufferScale.y);
+
+  uint64_t start = ImGui_ImplAC_GetMicroseconds();
+  memset(&range.stats, 0, sizeof(range.stats));
+  ImGui_ImplACH_BoundState state;
+  state.bd = bd;
+  state.stats = &range.stats;
+  ImGui_ImplAC_SetTarget(&state, &wrb->range_info, fb_width, fb_height);
+  ImGui_ImplAC_SetupRenderState(
+    draw_data,
+    wrb->range_pipeline,
+    command_buffer,
+    &wrb->upload,
+    &state,
+    fb_width,
+    fb_height);
+  ImGui_ImplAC_RecordDraws(
+    draw_data,
+    wrb->range_pipeline,
+    command_buffer,
+    wrb,
+    range,
+    &state,
+    fb_width,
+    fb_height);
+  ImGui_ImplAC_AddElapsed(&range.stats.record_cpu_ms, start);
+}
+
+IMGUI_IMPL_API void
+ac_imgui_renderer_end_draw_ranges(ImDrawData* draw_data)
+{
+  ImGui_ImplAC_Data*                 bd = ImGui_ImplAC_GetBackendData();
+  ImGui_ImplACH_WindowRenderBuffers* wrb =
+    ImGui_ImplAC_GetWindowRenderBuffers(draw_data);
+
+  for (const ImGui_ImplACH_DrawRange& range : wrb->draw_ranges)
+  {
+    bd->stats.draw_calls += range.stats.draw_calls;
+    bd->stats.binds_elided += range.stats.binds_elided;
+    bd->stats.scissors_elided += range.stats.scissors_elided;
+    bd->stats.draws_merged += range.stats.draws_merged;
+    bd->stats.record_cpu_ms += range.stats.record_cpu_ms;
+  }
+  wrb->draw_ranges.resize(0);
+}
+
+// Render function
+void
+ac_imgui_renderer_render_draw_data(
+  ImDrawData* draw_data,
+  ac_format   format,
+  ac_cmd      command_buffer)
+{
+  ac_imgui_renderer_render_info info = {};
+  info.target.color_format = format;
+  ac_imgui_renderer_render_draw_data_ex(draw_data, &info, command_buffer);
+}
+
+void
+ac_imgui_renderer_render_draw_data_ex(
+  ImDrawData*                          draw_data,
+  const ac_imgui_renderer_render_info* info,
+  ac_cmd                               command_buffer)
+{
+  // Avoid rendering when minimized, scale coordinates for retina displays
+  // (screen coordinates != framebuffer coordinates)
+  int fb_width =
+    (int)(draw_data->DisplaySize.x * draw_data->FramebufferScale.x);
+  int fb_height =
+    (int)(draw_data->DisplaySize.y * draw_data->FramebufferScale.y);
+  if (fb_width <= 0 || fb_height <= 0)
+  {
+    return;
+  }
+
+  ImGui_ImplAC_Data*           bd = ImGui_ImplAC_GetBackendData();
+  ac_imgui_renderer_init_info* v = &bd->init_info;
+
+  ImGui_ImplACH_WindowRenderBuffers* wrb =
+    ImGui_ImplAC_GetWindowRenderBuffers(draw_data);
+  ImGui_ImplAC_CheckNewFrame(wrb);
+  if (wrb->upload_draw_data != draw_data || wrb->upload_frame != bd->frame)
+  {
+    IM_ASSERT(
+      !v->device_local_draw_buffers &&
+      "Call ac_imgui_renderer_upload_draw_data() before rendering begins");
+    // Offscreen images can't be rendered inside the caller's rendering pass
+    for (int n = 0; n < draw_data->CmdListsCount; n++)
     {
-      CreateOrResizeBuffer(
-        rb->vertex_buffer,
-        vertex_size,
-        ac_buffer_usage_vertex_bit);
+      IM_ASSERT(
+        !bd->composite_requests.contains(draw_data->CmdLists[n]) &&
+        "Composited draw lists need ac_imgui_renderer_upload_draw_data()");
     }
-    if (
-      rb->index_buffer == NULL ||
-      ac_buffer_get_size(rb->index_buffer) < index_size)
+    if (!ImGui_ImplAC_UploadDrawData(draw_data, wrb, NULL))
     {
-      CreateOrResizeBuffer(
-        rb->index_buffer,
-        index_size,
-        ac_buffer_usage_index_bit);
+      return;
     }
+  }
+  ImGui_ImplACH_FrameRenderBuffers* rb = &wrb->upload;
 
-    // Upload vertex/index data into a single contiguous GPU buffer
-    ImDrawVert* vtx_dst = nullptr;
-    ImDrawIdx*  idx_dst = nullptr;
-
-    ac_result err = ac_buffer_map_memory(rb->vertex_buffer);
-    vtx_dst = (ImDrawVert*)ac_buffer_get_mapped_memory(rb->vertex_buffer);
-    check_ac_result(err);
-
-    err = ac_buffer_map_memory(rb->index_buffer);
-    idx_dst = (ImDrawIdx*)ac_buffer_get_mapped_memory(rb->index_buffer);
-    check_ac_result(err);
+  // The vertex layout is only known once the draw data is uploaded
+  ac_pipeline pipeline = ImGui_ImplAC_GetPipeline(info->target, rb->packed);
+  if (!pipeline)
+  {
+    return;
+  }
 
-    for (int n = 0; n < draw_data->CmdListsCount; n++)
+  if (!wrb->list_composites.empty())
+  {
+    ac_imgui_renderer_pipeline_key key = info->target;
+    key.blend_mode = ac_imgui_renderer_blend_mode_premultiplied;
+    bd->composite_pipeline = ImGui_ImplAC_GetPipeline(key, false);
+    if (!bd->composite_pipeline)
     {
-      const ImDrawList* cmd_list = draw_data->CmdLists[n];
-      memcpy(
-        vtx_dst,
-        cmd_list->VtxBuffer.Data,
-        cmd_list->VtxBuffer.Size * sizeof(ImDrawVert));
-      memcpy(
-        idx_dst,
-        cmd_list->IdxBuffer.Data,
-        cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx));
-      vtx_dst += cmd_list->VtxBuffer.Size;
-      idx_dst += cmd_list->IdxBuffer.Size;
+      // Draw the lists themselves instead
+      wrb->list_composites.resize(0);
     }
-
-    ac_buffer_unmap_memory(rb->vertex_buffer);
-    ac_buffer_unmap_memory(rb->index_buffer);
   }
 
+  uint64_t start = ImGui_ImplAC_GetMicroseconds();
+  ImGui_ImplAC_GpuScope(bd, command_buffer, "imgui", true);
+
   // Setup desired AC state
+  ImGui_ImplACH_BoundState state;
+  state.bd = bd;
+  state.stats = &bd->stats;
+  ImGui_ImplAC_SetTarget(&state, info, fb_width, fb_height);
   ImGui_ImplAC_SetupRenderState(
     draw_data,
     pipeline,
     command_buffer,
     rb,
+    &state,
     fb_width,
     fb_height);
 
-  // Will project scissor/clipping rectangles into framebuffer space
-  ImVec2 clip_off = draw_data->DisplayPos; // (0,0) unless using multi-viewports
-  ImVec2 clip_scale =
-    draw_data->FramebufferScale; // (1,1) unless using retina display which are
-                                 // often (2,2)
-
-  // Render command lists
-  // (Because we merged all buffers into a single one, we maintain our own
-  // offset into them)
-  int global_vtx_offset = 0;
-  int global_idx_offset = 0;
-  for (int n = 0; n < draw_data->CmdListsCount; n++)
+  if (v->indirect_draws)
   {
-    const ImDrawList* cmd_list = draw_data->CmdLists[n];
-    for (int cmd_i = 0; cmd_i < cmd_list->CmdBuffer.Size; cmd_i++)
+    // Clipping happens in the pixel shader, the scissor only has to cover
+    // the framebuffer
+    int32_t full_scissor[4] = {0, 0, fb_width, fb_height};
+    for (const ImGui_ImplACH_IndirectBatch& batch : wrb->indirect_batches)
     {
-      const ImDrawCmd* pcmd = &cmd_list->CmdBuffer[cmd_i];
-      if (pcmd->UserCallback != nullptr)
-      {
-        // User callback, registered via ImDrawList::AddCallback()
-        // (ImDrawCallback_ResetRenderState is a special callback value used by
-        // the user to request the renderer to reset render state.)
-        if (pcmd->UserCallback == ImDrawCallback_ResetRenderState)
-        {
-          ImGui_ImplAC_SetupRenderState(
-            draw_data,
-            pipeline,
-            command_buffer,
-            rb,
-            fb_width,
-            fb_height);
-        }
-        else
-        {
-          pcmd->UserCallback(cmd_list, pcmd);
-        }
-      }
-      else
+      if (
+        batch.draw_count > 0 &&
+        ImGui_ImplAC_SetScissor(command_buffer, &state, full_scissor))
       {
-        // Project scissor/clipping rectangles into framebuffer space
-        ImVec2 clip_min(
-          (pcmd->ClipRect.x - clip_off.x) * clip_scale.x,
-          (pcmd->ClipRect.y - clip_off.y) * clip_scale.y);
-        ImVec2 clip_max(
-          (pcmd->ClipRect.z - clip_off.x) * clip_scale.x,
-          (pcmd->ClipRect.w - clip_off.y) * clip_scale.y);
-
-        // Clamp to viewport as vkCmdSetScissor() won't accept values that are
-        // off bounds
-        if (clip_min.x < 0.0f)
-        {
-          clip_min.x = 0.0f;
-        }
-        if (clip_min.y < 0.0f)
-        {
-          clip_min.y = 0.0f;
-        }
-        if (clip_max.x > fb_width)
-        {
-          clip_max.x = (float)fb_width;
-        }
-        if (clip_max.y > fb_height)
-        {
-          clip_max.y = (float)fb_height;
-        }
-        if (clip_max.x <= clip_min.x || clip_max.y <= clip_min.y)
-        {
-          continue;
-        }
-
-        // Apply scissor/clipping rectangle
-        ac_cmd_set_scissor(
+        ImGui_ImplAC_BindSets(command_buffer, &state, 0);
+        ac_cmd_draw_indexed_indirect(
           command_buffer,
-          (int32_t)clip_min.x,
-          (int32_t)clip_min.y,
-          (uint32_t)(clip_max.x - clip_min.x),
-          (uint32_t)(clip_max.y - clip_min.y));
-
-        // Bind DescriptorSet with font or user texture
-        uint32_t desc_set[1] = {(uint32_t)(uintptr_t)pcmd->TextureId};
-        if (sizeof(ImTextureID) < sizeof(ImU64))
-        {
-          // We don't support texture switches if ImTextureID hasn't been
-          // redefined to be 64-bit. Do a flaky check that other textures
-          // haven't been used.
-          IM_ASSERT(pcmd->TextureId == (ImTextureID)(uintptr_t)bd->font_set);
-          desc_set[0] = (uint32_t)(uintptr_t)bd->font_set;
-        }
-        ac_cmd_bind_set(command_buffer, bd->db, ac_space0, 0);
-        ac_cmd_bind_set(command_buffer, bd->db, ac_space1, desc_set[0]);
+          rb->indirect_buffer,
+          rb->indirect_offset +
+            batch.first_draw * sizeof(ImGui_ImplACH_DrawIndexedIndirect),
+          batch.draw_count,
+          sizeof(ImGui_ImplACH_DrawIndexedIndirect));
+        state.stats->draw_calls++;
+      }
 
-        // Draw
-        ac_cmd_draw_indexed(
+      const ImDrawCmd* pcmd = batch.callback;
+      if (pcmd == nullptr)
+      {
+        continue;
+      }
+      if (pcmd->UserCallback == ImDrawCallback_ResetRenderState)
+      {
+        ImGui_ImplAC_SetupRenderState(
+          draw_data,
+          pipeline,
           command_buffer,
-          pcmd->ElemCount,
-          1,
-          pcmd->IdxOffset + global_idx_offset,
-          pcmd->VtxOffset + global_vtx_offset,
-          0);
+          rb,
+          &state,
+          fb_width,
+          fb_height);
+      }
+      else
+      {
+        pcmd->UserCallback(batch.cmd_list, pcmd);
+        ImGui_ImplAC_InvalidateBoundState(&state);
       }
     }
-    global_idx_offset += cmd_list->IdxBuffer.Size;
-    global_vtx_offset += cmd_list->VtxBuffer.Size;
+  }
+  else
+  {
+    ImGui_ImplACH_DrawRange range = {};
+    range.list_count = draw_data->CmdListsCount;
+    ImGui_ImplAC_RecordDraws(
+      draw_data,
+      pipeline,
+      command_buffer,
+      wrb,
+      range,
+      &state,
+      fb_width,
+      fb_height);
   }
 
   // Note: at this point both vkCmdSetViewport() and vkCmdSetScissor() have been
@@ -419,79 +2923,432 @@ ac_imgui_renderer_render_draw_data(
   // technically this is not perfect. (See github #4644)
   ac_cmd_set_scissor(
     command_buffer,
-    0,
-    0,
-    (uint32_t)fb_width,
-    (uint32_t)fb_height);
+    state.bounds[0],
+    state.bounds[1],
+    (uint32_t)(state.bounds[2] - state.bounds[0]),
+    (uint32_t)(state.bounds[3] - state.bounds[1]));
+
+  ImGui_ImplAC_GpuScope(bd, command_buffer, "imgui", false);
+  ImGui_ImplAC_AddElapsed(&bd->stats.record_cpu_ms, start);
 }
 
-ac_result
-ac_imgui_renderer_create_font_texture()
+// Gathers the lists of all draw data into batch_draw_data and uploads them
+// as one range of the batch render buffers
+static bool
+ImGui_ImplAC_UploadBatch(
+  ImDrawData* const* draw_datas,
+  uint32_t           count,
+  ac_cmd             command_buffer)
 {
-  ImGuiIO&                     io = ImGui::GetIO();
   ImGui_ImplAC_Data*           bd = ImGui_ImplAC_GetBackendData();
   ac_imgui_renderer_init_info* v = &bd->init_info;
+  IM_ASSERT(
+    !v->indirect_draws && !v->cache_draw_lists &&
+    "Batches need the direct draw path with one upload");
+
+  ImDrawData* batch = &bd->batch_draw_data;
+  batch->Clear();
+  if (count > 0)
+  {
+    // Only used to size streamed textures and as the packing origin
+    batch->FramebufferScale = draw_datas[0]->FramebufferScale;
+    batch->DisplayPos = draw_datas[0]->DisplayPos;
+  }
+  for (uint32_t i = 0; i < count; i++)
+  {
+    const ImDrawData* draw_data = draw_datas[i];
+    for (int n = 0; n < draw_data->CmdListsCount; n++)
+    {
+      batch->CmdLists.push_back(draw_data->CmdLists[n]);
+    }
+    batch->CmdListsCount += draw_data->CmdListsCount;
+    batch->TotalVtxCount += draw_data->TotalVtxCount;
+    batch->TotalIdxCount += draw_data->TotalIdxCount;
+  }
+  batch->Valid = true;
 
-  ac_queue queue = ac_device_get_queue(v->device, ac_queue_type_graphics);
+  return ImGui_ImplAC_UploadDrawData(
+    batch,
+    &bd->BatchRenderBuffers,
+    command_buffer);
+}
 
-  ac_cmd_pool pool;
+void
+ac_imgui_renderer_upload_draw_data_batch(
+  ImDrawData* const* draw_datas,
+  uint32_t           count,
+  ac_cmd             command_buffer)
+{
+  ImGui_ImplAC_UploadBatch(draw_datas, count, command_buffer);
+}
 
-  ac_cmd_pool_info pool_info = {};
-  pool_info.queue = queue;
-  AC_RIF(ac_create_cmd_pool(v->device, &pool_info, &pool));
+void
+ac_imgui_renderer_render_draw_data_batch(
+  ImDrawData* const*                   draw_datas,
+  const ac_imgui_renderer_render_info* infos,
+  uint32_t                             count,
+  ac_cmd                               command_buffer)
+{
+  ImGui_ImplAC_Data*                 bd = ImGui_ImplAC_GetBackendData();
+  ac_imgui_renderer_init_info*       v = &bd->init_info;
+  ImGui_ImplACH_WindowRenderBuffers* wrb = &bd->BatchRenderBuffers;
 
-  ac_cmd cmd;
-  AC_RIF(ac_create_cmd(pool, &cmd));
+  ImGui_ImplAC_CheckNewFrame(wrb);
+  if (
+    wrb->upload_draw_data != &bd->batch_draw_data ||
+    wrb->upload_frame != bd->frame)
+  {
+    IM_ASSERT(
+      !v->device_local_draw_buffers &&
+      "Call ac_imgui_renderer_upload_draw_data_batch() before rendering");
+    if (!ImGui_ImplAC_UploadBatch(draw_datas, count, NULL))
+    {
+      return;
+    }
+  }
 
-  unsigned char* pixels;
-  int            width, height;
-  io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
-  size_t upload_size = width * height * 4 * sizeof(char);
+  uint64_t start = ImGui_ImplAC_GetMicroseconds();
+  ImGui_ImplAC_GpuScope(bd, command_buffer, "imgui batch", true);
 
-  ac_result err;
+  // All draw data share the batch upload, each one brings its projection and
+  // target and starts where the geometry of the previous one ends
+  ImGui_ImplACH_BoundState state;
+  state.bd = bd;
+  state.stats = &bd->stats;
+  ImGui_ImplACH_DrawRange range = {};
 
-  // Create the Image:
+  // Union of the target bounds
+  int32_t bounds[4] = {INT32_MAX, INT32_MAX, INT32_MIN, INT32_MIN};
+  for (uint32_t i = 0; i < count; i++)
   {
-    ac_image_info info = {};
-    info.type = ac_image_type_2d;
-    info.format = ac_format_r8g8b8a8_unorm;
-    info.width = width;
-    info.height = height;
-    info.layers = 1;
-    info.samples = 1;
-    info.levels = 1;
-    info.usage = ac_image_usage_srv_bit | ac_image_usage_transfer_dst_bit;
+    ImDrawData* draw_data = draw_datas[i];
+    range.list_count = draw_data->CmdListsCount;
 
-    err = ac_create_image(v->device, &info, &bd->font_image);
-    check_ac_result(err);
+    int fb_width =
+      (int)(draw_data->DisplaySize.x * draw_data->FramebufferScale.x);
+    int fb_height =
+      (int)(draw_data->DisplaySize.y * draw_data->FramebufferScale.y);
+    ac_pipeline pipeline =
+      ImGui_ImplAC_GetPipeline(infos[i].target, wrb->upload.packed);
+    if (fb_width > 0 && fb_height > 0 && pipeline)
+    {
+      ImGui_ImplAC_SetTarget(&state, &infos[i], fb_width, fb_height);
+      ImGui_ImplAC_SetupRenderState(
+        draw_data,
+        pipeline,
+        command_buffer,
+        &wrb->upload,
+        &state,
+        fb_width,
+        fb_height);
+      ImGui_ImplAC_RecordDraws(
+        draw_data,
+        pipeline,
+        command_buffer,
+        wrb,
+        range,
+        &state,
+        fb_width,
+        fb_height);
+
+      for (int c = 0; c < 2; c++)
+      {
+        if (state.bounds[c] < bounds[c])
+        {
+          bounds[c] = state.bounds[c];
+        }
+        if (state.bounds[c + 2] > bounds[c + 2])
+        {
+          bounds[c + 2] = state.bounds[c + 2];
+        }
+      }
+    }
+
+    range.vtx_offset += draw_data->TotalVtxCount;
+    range.idx_offset += draw_data->TotalIdxCount;
   }
 
-  // Create the Descriptor Set:
-  bd->font_set = ac_imgui_renderer_create_texture(bd->font_image);
+  // Leave the scissor covering every target, as a single render would
+  if (bounds[2] > bounds[0] && bounds[3] > bounds[1])
+  {
+    ac_cmd_set_scissor(
+      command_buffer,
+      bounds[0],
+      bounds[1],
+      (uint32_t)(bounds[2] - bounds[0]),
+      (uint32_t)(bounds[3] - bounds[1]));
+  }
 
-  // Create the Upload Buffer:
+  ImGui_ImplAC_GpuScope(bd, command_buffer, "imgui batch", false);
+  ImGui_ImplAC_AddElapsed(&bd->stats.record_cpu_ms, start);
+}
+
+// Uploads the bands of the atlas which differ from the last upload into the
+// existing image, which keeps its descriptor
+static ac_result
+ImGui_ImplAC_UpdateFontTexture(
+  ac_cmd         command_buffer,
+  unsigned char* pixels,
+  int            width,
+  int            height)
+{
+  ImGui_ImplAC_Data*           bd = ImGui_ImplAC_GetBackendData();
+  ac_imgui_renderer_init_info* v = &bd->init_info;
+  size_t                       pitch = (size_t)width * bd->font_bytes_per_pixel;
+
+  // Dirty bands, consecutive ones merged into one region
+  ImVector<ac_buffer_image_copy> regions;
+  uint64_t                       upload_size = 0;
+  for (int y = 0; y < height; y += FONT_BAND_HEIGHT)
+  {
+    int    rows = height - y < FONT_BAND_HEIGHT ? height - y : FONT_BAND_HEIGHT;
+    size_t offset = (size_t)y * pitch;
+    size_t size = (size_t)rows * pitch;
+    if (memcmp(bd->font_pixels.Data + offset, pixels + offset, size) == 0)
+    {
+      continue;
+    }
+
+    if (!regions.empty())
+    {
+      ac_buffer_image_copy& last = regions.back();
+      if (last.y + last.height == (uint32_t)y)
+      {
+        last.height += rows;
+        upload_size += size;
+        continue;
+      }
+    }
+
+    upload_size = ImGui_ImplAC_AlignUp(upload_size, FONT_UPLOAD_ALIGNMENT);
+
+    ac_buffer_image_copy region = {};
+    region.buffer_offset = upload_size;
+    region.y = y;
+    region.width = width;
+    region.height = rows;
+    regions.push_back(region);
+    upload_size += size;
+  }
+
+  if (regions.empty())
+  {
+    return ac_result_success;
+  }
+
+  ac_buffer staging_buffer;
   {
     ac_buffer_info buffer_info = {};
     buffer_info.size = upload_size;
     buffer_info.usage = ac_buffer_usage_transfer_src_bit;
     buffer_info.memory_usage = ac_memory_usage_cpu_to_gpu;
 
-    err = ac_create_buffer(v->device, &buffer_info, &bd->staging_buffer);
+    AC_RIF(ac_create_buffer(v->device, &buffer_info, &staging_buffer));
+  }
 
-    check_ac_result(err);
+  ac_result err = ac_buffer_map_memory(staging_buffer);
+  if (err != ac_result_success)
+  {
+    ac_destroy_buffer(staging_buffer);
+    return err;
+  }
+  char* map = (char*)ac_buffer_get_mapped_memory(staging_buffer);
+  for (const ac_buffer_image_copy& region : regions)
+  {
+    memcpy(
+      map + region.buffer_offset,
+      pixels + (size_t)region.y * pitch,
+      (size_t)region.height * pitch);
+  }
+  ac_buffer_unmap_memory(staging_buffer);
+
+  ac_image_barrier copy_barrier[1] = {};
+  copy_barrier[0].src_stage = ac_pipeline_stage_pixel_shader_bit;
+  copy_barrier[0].dst_stage = ac_pipeline_stage_transfer_bit;
+  copy_barrier[0].src_access = ac_access_shader_read_bit;
+  copy_barrier[0].dst_access = ac_access_transfer_write_bit;
+  copy_barrier[0].old_layout = ac_image_layout_shader_read;
+  copy_barrier[0].new_layout = ac_image_layout_transfer_dst;
+  copy_barrier[0].image = bd->font_image;
+  copy_barrier[0].range.layers = 1;
+  copy_barrier[0].range.levels = 1;
+
+  ac_cmd_barrier(command_buffer, 0, NULL, 1, copy_barrier);
+
+  for (const ac_buffer_image_copy& region : regions)
+  {
+    ac_cmd_copy_buffer_to_image(
+      command_buffer,
+      staging_buffer,
+      bd->font_image,
+      &region);
+  }
+
+  ac_image_barrier use_barrier[1] = {};
+  use_barrier[0].src_stage = ac_pipeline_stage_transfer_bit;
+  use_barrier[0].dst_stage = ac_pipeline_stage_pixel_shader_bit;
+  use_barrier[0].src_access = ac_access_transfer_write_bit;
+  use_barrier[0].dst_access = ac_access_shader_read_bit;
+  use_barrier[0].old_layout = ac_image_layout_transfer_dst;
+  use_barrier[0].new_layout = ac_image_layout_shader_read;
+  use_barrier[0].image = bd->font_image;
+  use_barrier[0].range.layers = 1;
+  use_barrier[0].range.levels = 1;
+
+  ac_cmd_barrier(command_buffer, 0, NULL, 1, use_barrier);
+
+  ImGui_ImplAC_Garbage garbage = {};
+  garbage.buffer = staging_buffer;
+  garbage.frame = bd->frame;
+  bd->garbage.push_back(garbage);
+
+  memcpy(bd->font_pixels.Data, pixels, pitch * height);
+  bd->texture_generation++;
+
+  return ac_result_success;
+}
+
+// Custom rects of a distance field atlas hold coverage, e.g. the mouse cursors
+// and the AddCustomRect*() content of the application. Their copy in
+// converted gets the distance slope of the glyphs, a coverage c sits c - 0.5
+// pixels from the edge, so thresholding gives back about c at scale 1.
+static unsigned char*
+ImGui_ImplAC_ConvertCustomRectsToSDF(
+  const ImFontAtlas*       atlas,
+  const unsigned char*     pixels,
+  int                      width,
+  int                      height,
+  ImVector<unsigned char>* converted)
+{
+  converted->resize(width * height);
+  memcpy(converted->Data, pixels, (size_t)width * height);
+  for (const ImFontAtlasCustomRect& r : atlas->CustomRects)
+  {
+    if (!r.IsPacked())
+    {
+      continue;
+    }
+    for (int y = r.Y; y < r.Y + r.Height; y++)
+    {
+      unsigned char* row = converted->Data + (size_t)y * width;
+      for (int x = r.X; x < r.X + r.Width; x++)
+      {
+        float d = FONT_SDF_ON_EDGE +
+                  (row[x] / 255.0f - 0.5f) * FONT_SDF_PIXEL_DIST_SCALE;
+        row[x] = (unsigned char)(d + 0.5f);
+      }
+    }
+  }
+  return converted->Data;
+}
+
+ac_result
+ac_imgui_renderer_create_font_texture(ac_cmd command_buffer)
+{
+  ImGuiIO&                     io = ImGui::GetIO();
+  ImGui_ImplAC_Data*           bd = ImGui_ImplAC_GetBackendData();
+  ac_imgui_renderer_init_info* v = &bd->init_info;
+
+  unsigned char*          pixels;
+  int                     width, height, bytes_per_pixel;
+  ac_format               format;
+  uint8_t                 kind;
+  ImVector<unsigned char> sdf_pixels;
+  if (io.Fonts->TexPixelsUseColors)
+  {
+    // Colored glyphs can't be expanded from a single channel
+    io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height, &bytes_per_pixel);
+    format = ac_format_r8g8b8a8_unorm;
+    kind = TEXTURE_COLOR;
+  }
+  else
+  {
+    // The atlas is pure coverage or distance, the shaders expand it to white
+    // with alpha
+    io.Fonts->GetTexDataAsAlpha8(&pixels, &width, &height, &bytes_per_pixel);
+    format = ac_format_r8_unorm;
+    kind = TEXTURE_ALPHA;
+    if (io.Fonts->Flags & ImFontAtlasFlags_SignedDistanceField)
+    {
+      kind = TEXTURE_SDF;
+      pixels = ImGui_ImplAC_ConvertCustomRectsToSDF(
+        io.Fonts,
+        pixels,
+        width,
+        height,
+        &sdf_pixels);
+    }
+  }
+  size_t upload_size = (size_t)width * height * bytes_per_pixel;
+
+  // A rebuilt atlas of the same size and format is patched in place
+  if (
+    v->partial_font_updates && bd->font_image && width == bd->font_width &&
+    height == bd->font_height && bytes_per_pixel == bd->font_bytes_per_pixel)
+  {
+    AC_RIF(
+      ImGui_ImplAC_UpdateFontTexture(command_buffer, pixels, width, height));
+    bd->slot_kinds[(uint32_t)(uintptr_t)bd->font_set - 1] = kind;
+    io.Fonts->SetTexID((ImTextureID)(uintptr_t)bd->font_set);
+    return ac_result_success;
+  }
+
+  ac_result err;
+
+  // Create the Upload Buffer:
+  ac_buffer staging_buffer;
+  {
+    ac_buffer_info buffer_info = {};
+    buffer_info.size = upload_size;
+    buffer_info.usage = ac_buffer_usage_transfer_src_bit;
+    buffer_info.memory_usage = ac_memory_usage_cpu_to_gpu;
+
+    AC_RIF(ac_create_buffer(v->device, &buffer_info, &staging_buffer));
   }
 
   // Upload to Buffer:
   {
     char* map = nullptr;
-    err = ac_buffer_map_memory(bd->staging_buffer);
-    check_ac_result(err);
-    map = (char*)ac_buffer_get_mapped_memory(bd->staging_buffer);
+    err = ac_buffer_map_memory(staging_buffer);
+    if (err != ac_result_success)
+    {
+      ac_destroy_buffer(staging_buffer);
+      return err;
+    }
+    map = (char*)ac_buffer_get_mapped_memory(staging_buffer);
     memcpy(map, pixels, upload_size);
-    ac_buffer_unmap_memory(bd->staging_buffer);
+    ac_buffer_unmap_memory(staging_buffer);
+  }
+
+  // Create the Image:
+  ac_image font_image;
+  {
+    ac_image_info info = {};
+    info.type = ac_image_type_2d;
+    info.format = format;
+    info.width = width;
+    info.height = height;
+    info.layers = 1;
+    info.samples = 1;
+    info.levels = 1;
+    info.usage = ac_image_usage_srv_bit | ac_image_usage_transfer_dst_bit;
+
+    err = ac_create_image(v->device, &info, &font_image);
+    if (err != ac_result_success)
+    {
+      ac_destroy_buffer(staging_buffer);
+      return err;
+    }
   }
 
-  ac_begin_cmd(cmd);
+  // Create the Descriptor Set:
+  ImTextureID font_set = ImGui_ImplAC_CreateTexture(font_image, kind);
+  if (!font_set)
+  {
+    ac_destroy_image(font_image);
+    ac_destroy_buffer(staging_buffer);
+    return ac_result_out_of_host_memory;
+  }
 
   // Copy to Image:
   {
@@ -502,19 +3359,19 @@ ac_imgui_renderer_create_font_texture()
     copy_barrier[0].dst_access = ac_access_transfer_write_bit;
     copy_barrier[0].old_layout = ac_image_layout_undefined;
     copy_barrier[0].new_layout = ac_image_layout_transfer_dst;
-    copy_barrier[0].image = bd->font_image;
+    copy_barrier[0].image = font_image;
     copy_barrier[0].range.layers = 1;
     copy_barrier[0].range.levels = 1;
 
-    ac_cmd_barrier(cmd, 0, NULL, 1, copy_barrier);
+    ac_cmd_barrier(command_buffer, 0, NULL, 1, copy_barrier);
 
     ac_buffer_image_copy region = {};
     region.width = width;
     region.height = height;
     ac_cmd_copy_buffer_to_image(
-      cmd,
-      bd->staging_buffer,
-      bd->font_image,
+      command_buffer,
+      staging_buffer,
+      font_image,
       &region);
 
     ac_image_barrier use_barrier[1] = {};
@@ -524,24 +3381,36 @@ ac_imgui_renderer_create_font_texture()
     use_barrier[0].dst_access = ac_access_shader_read_bit;
     use_barrier[0].old_layout = ac_image_layout_transfer_dst;
     use_barrier[0].new_layout = ac_image_layout_shader_read;
-    use_barrier[0].image = bd->font_image;
+    use_barrier[0].image = font_image;
     use_barrier[0].range.layers = 1;
     use_barrier[0].range.levels = 1;
 
-    ac_cmd_barrier(cmd, 0, NULL, 1, use_barrier);
+    ac_cmd_barrier(command_buffer, 0, NULL, 1, use_barrier);
   }
 
-  ac_end_cmd(cmd);
-
-  ac_queue_submit_info submit_info = {};
-  submit_info.cmd_count = 1;
-  submit_info.cmds = &cmd;
-  AC_RIF(ac_queue_submit(queue, &submit_info));
+  // The staging buffer and a previous atlas are destroyed once the frames in
+  // flight have retired, instead of waiting for the queue here
+  ImGui_ImplAC_Garbage garbage = {};
+  garbage.buffer = staging_buffer;
+  garbage.image = bd->font_image;
+  garbage.frame = bd->frame;
+  bd->garbage.push_back(garbage);
 
-  AC_RIF(ac_queue_wait_idle(queue));
+  if (bd->font_set)
+  {
+    ac_imgui_renderer_destroy_texture(bd->font_set);
+  }
 
-  ac_destroy_cmd(cmd);
-  ac_destroy_cmd_pool(pool);
+  bd->font_image = font_image;
+  bd->font_set = font_set;
+  if (v->partial_font_updates)
+  {
+    bd->font_pixels.resize((int)upload_size);
+    memcpy(bd->font_pixels.Data, pixels, upload_size);
+  }
+  bd->font_width = width;
+  bd->font_height = height;
+  bd->font_bytes_per_pixel = bytes_per_pixel;
 
   // Store our identifier
   io.Fonts->SetTexID((ImTextureID)(uintptr_t)bd->font_set);
@@ -558,9 +3427,23 @@ ImGui_ImplAC_CreateShaderModules(ac_device device)
   {
     ac_shader_info shader_info = {};
     shader_info.stage = ac_shader_stage_vertex;
-    shader_info.code = imgui_vs[0];
+    shader_info.code = bd->init_info.indirect_draws      ? imgui_vs_indirect[0]
+                       : bd->init_info.bindless_textures ? imgui_vs_bindless[0]
+                                                         : imgui_vs[0];
+
+    ac_result err = ac_create_shader(device, &shader_info, &bd->vertex_shader);
+    check_ac_result(err);
+  }
+
+  // Uploads which don't fit the packed layout still use imgui_vs
+  if (bd->init_info.packed_vertices && bd->packed_vertex_shader == NULL)
+  {
+    ac_shader_info shader_info = {};
+    shader_info.stage = ac_shader_stage_vertex;
+    shader_info.code = imgui_vs_packed[0];
 
-    ac_result err = ac_create_shader(device, &shader_info, &bd->vertex_shader);
+    ac_result err =
+      ac_create_shader(device, &shader_info, &bd->packed_vertex_shader);
     check_ac_result(err);
   }
 
@@ -568,7 +3451,9 @@ ImGui_ImplAC_CreateShaderModules(ac_device device)
   {
     ac_shader_info shader_info = {};
     shader_info.stage = ac_shader_stage_pixel;
-    shader_info.code = imgui_fs[0];
+    shader_info.code = bd->init_info.indirect_draws      ? imgui_fs_indirect[0]
+                       : bd->init_info.bindless_textures ? imgui_fs_bindless[0]
+                                                         : imgui_fs[0];
 
     ac_result err = ac_create_shader(device, &shader_info, &bd->pixel_shader);
     check_ac_result(err);
@@ -580,6 +3465,8 @@ ImGui_ImplAC_CreatePipeline(
   ac_device    device,
   uint32_t     samples,
   ac_format    format,
+  bool         premultiplied,
+  bool         packed,
   ac_pipeline* pipeline)
 {
   ImGui_ImplAC_Data* bd = ImGui_ImplAC_GetBackendData();
@@ -598,12 +3485,43 @@ ImGui_ImplAC_CreatePipeline(
   vl.attributes[2].semantic = ac_attribute_semantic_color;
   vl.attributes[2].format = ac_format_r8g8b8a8_unorm;
   vl.attributes[2].offset = IM_OFFSETOF(ImDrawVert, col);
+  if (packed)
+  {
+    vl.bindings[0].stride = sizeof(ImGui_ImplACH_PackedVert);
+    vl.attributes[0].format = ac_format_r16g16_sint;
+    vl.attributes[0].offset = IM_OFFSETOF(ImGui_ImplACH_PackedVert, pos);
+    vl.attributes[1].format = ac_format_r16g16_unorm;
+    vl.attributes[1].offset = IM_OFFSETOF(ImGui_ImplACH_PackedVert, uv);
+    vl.attributes[2].offset = IM_OFFSETOF(ImGui_ImplACH_PackedVert, col);
+  }
+  if (bd->init_info.bindless_textures)
+  {
+    vl.binding_count = 2;
+    vl.bindings[1].stride = sizeof(uint32_t);
+    vl.bindings[1].input_rate = ac_input_rate_vertex;
+    vl.attribute_count = 4;
+    vl.attributes[3].semantic = ac_attribute_semantic_texcoord1;
+    vl.attributes[3].format = ac_format_r32_uint;
+    vl.attributes[3].binding = 1;
+    vl.attributes[3].offset = 0;
+  }
+  if (bd->init_info.indirect_draws)
+  {
+    vl.binding_count = 3;
+    vl.bindings[2].stride = sizeof(ImVec4);
+    vl.bindings[2].input_rate = ac_input_rate_instance;
+    vl.attribute_count = 5;
+    vl.attributes[4].semantic = ac_attribute_semantic_texcoord2;
+    vl.attributes[4].format = ac_format_r32g32b32a32_sfloat;
+    vl.attributes[4].binding = 2;
+    vl.attributes[4].offset = 0;
+  }
 
   ac_pipeline_info pipe_info = {};
   pipe_info.type = ac_pipeline_type_graphics;
 
   ac_graphics_pipeline_info* info = &pipe_info.graphics;
-  info->vertex_shader = bd->vertex_shader;
+  info->vertex_shader = packed ? bd->packed_vertex_shader : bd->vertex_shader;
   info->pixel_shader = bd->pixel_shader;
   info->dsl = bd->dsl;
   info->vertex_layout = vl;
@@ -615,7 +3533,8 @@ ImGui_ImplAC_CreatePipeline(
 
   ac_blend_attachment_state color_attachment[1] = {};
 
-  color_attachment[0].src_factor = ac_blend_factor_src_alpha;
+  color_attachment[0].src_factor =
+    premultiplied ? ac_blend_factor_one : ac_blend_factor_src_alpha;
   color_attachment[0].dst_factor = ac_blend_factor_one_minus_src_alpha;
   color_attachment[0].op = ac_blend_op_add;
   color_attachment[0].src_alpha_factor = ac_blend_factor_one;
@@ -633,6 +3552,54 @@ ImGui_ImplAC_CreatePipeline(
   return err;
 }
 
+// Creates a descriptor buffer holding the sampler and the next
+// TEXTURE_PAGE_SIZE texture sets, or the whole bindless array
+static bool
+ImGui_ImplAC_AddTexturePage()
+{
+  ImGui_ImplAC_Data*           bd = ImGui_ImplAC_GetBackendData();
+  ac_imgui_renderer_init_info* v = &bd->init_info;
+
+  uint32_t capacity = v->bindless_textures ? MAX_TEXTURES : TEXTURE_PAGE_SIZE;
+  if (v->bindless_textures && bd->texture_pages.Size > 0)
+  {
+    // The bindless array is sized in the shader and can't grow
+    return false;
+  }
+
+  ac_descriptor_buffer_info db_info = {};
+  db_info.dsl = bd->dsl;
+  db_info.max_sets[0] = 1;
+  db_info.max_sets[1] = v->bindless_textures ? 1 : TEXTURE_PAGE_SIZE;
+
+  ac_descriptor_buffer db;
+  if (ac_create_descriptor_buffer(v->device, &db_info, &db) !=
+      ac_result_success)
+  {
+    return false;
+  }
+
+  ac_descriptor descritptor = {};
+  descritptor.sampler = bd->font_sampler;
+  ac_descriptor_write write = {};
+  write.count = 1;
+  write.descriptors = &descritptor;
+  write.type = ac_descriptor_type_sampler;
+
+  ac_update_set(db, ac_space0, 0, 1, &write);
+
+  // Pushed in reverse so the lowest slots are handed out first
+  uint32_t first = (uint32_t)bd->texture_pages.Size * TEXTURE_PAGE_SIZE;
+  for (uint32_t i = capacity; i > 0; --i)
+  {
+    bd->free_slots.push_back(first + i - 1);
+  }
+  bd->slot_kinds.resize((int)(first + capacity), 0);
+  bd->texture_pages.push_back(db);
+
+  return true;
+}
+
 bool
 ImGui_ImplAC_CreateDeviceObjects()
 {
@@ -658,18 +3625,6 @@ ImGui_ImplAC_CreateDeviceObjects()
     check_ac_result(err);
   }
 
-  if (!bd->db)
-  {
-    ac_descriptor_buffer_info db_info = {};
-    db_info.dsl = bd->dsl;
-    db_info.max_sets[0] = 1;
-    db_info.max_sets[1] = MAX_TEXTURES;
-
-    err = ac_create_descriptor_buffer(v->device, &db_info, &bd->db);
-
-    check_ac_result(err);
-  }
-
   if (!bd->font_sampler)
   {
     ac_sampler_info info = {};
@@ -684,28 +3639,35 @@ ImGui_ImplAC_CreateDeviceObjects()
     err = ac_create_sampler(v->device, &info, &bd->font_sampler);
 
     check_ac_result(err);
+  }
 
-    ac_descriptor descritptor = {};
-    descritptor.sampler = bd->font_sampler;
-    ac_descriptor_write write = {};
-    write.count = 1;
-    write.descriptors = &descritptor;
-    write.type = ac_descriptor_type_sampler;
+  if (bd->texture_pages.empty())
+  {
+    ImGui_ImplAC_AddTexturePage();
+  }
 
-    ac_update_set(bd->db, ac_space0, 0, 1, &write);
+  // Failures are reported through check_ac_result_fn and retried on first use
+  for (uint32_t i = 0; i < v->pipeline_key_count; i++)
+  {
+    ImGui_ImplAC_GetPipeline(v->pipeline_keys[i], v->packed_vertices);
   }
 
   return true;
 }
 
-void
-ac_imgui_renderer_destroy_font_upload_objects()
+static void
+ImGui_ImplAC_DestroyWindowRenderBuffers(ImGui_ImplACH_WindowRenderBuffers* wrb)
 {
-  ImGui_ImplAC_Data*           bd = ImGui_ImplAC_GetBackendData();
-  ac_imgui_renderer_init_info* v = &bd->init_info;
-
-  ac_destroy_buffer(bd->staging_buffer);
-  bd->staging_buffer = NULL;
+  ImGui_ImplAC_DestroyRingBuffer(&wrb->vertex_ring);
+  ImGui_ImplAC_DestroyRingBuffer(&wrb->index_ring);
+  ImGui_ImplAC_DestroyRingBuffer(&wrb->device_ring);
+  ImGui_ImplAC_RetireListCache(wrb);
+  for (ImGui_ImplACH_CompositeEntry& entry : wrb->composites)
+  {
+    ImGui_ImplAC_RetireComposite(&entry);
+  }
+  wrb->composites.clear();
+  wrb->list_composites.clear();
 }
 
 void
@@ -714,37 +3676,82 @@ ImGui_ImplAC_DestroyDeviceObjects()
   ImGui_ImplAC_Data*           bd = ImGui_ImplAC_GetBackendData();
   ac_imgui_renderer_init_info* v = &bd->init_info;
 
-  ImGui_ImplACH_WindowRenderBuffers* wrb = &bd->MainWindowRenderBuffers;
+  ImGui_ImplAC_DestroyWindowRenderBuffers(&bd->BatchRenderBuffers);
 
-  for (uint32_t i = 0; i < wrb->Count; ++i)
+  for (ImGui_ImplAC_Garbage& garbage : bd->garbage)
   {
-    ac_destroy_buffer(wrb->FrameRenderBuffers[i].index_buffer);
-    ac_destroy_buffer(wrb->FrameRenderBuffers[i].vertex_buffer);
+    ac_destroy_buffer(garbage.buffer);
+    ac_destroy_image(garbage.image);
   }
-  IM_FREE(wrb->FrameRenderBuffers);
-  ac_imgui_renderer_destroy_font_upload_objects();
-  ac_destroy_buffer(bd->staging_buffer);
-  bd->staging_buffer = NULL;
+  bd->garbage.clear();
 
-  if (bd->pipelines[0])
+  for (ImGui_ImplACH_PipelineEntry& entry : bd->pipelines)
+  {
+    ac_destroy_pipeline(entry.pipeline);
+  }
+  bd->pipelines.clear();
+  for (ImGui_ImplACH_StreamedTexture& entry : bd->streamed_textures)
+  {
+    ac_destroy_image(entry.image);
+  }
+  bd->streamed_textures.clear();
+  bd->free_streamed_textures.clear();
+  bd->streamed_texture_bytes = 0;
+  for (ac_descriptor_buffer db : bd->texture_pages)
   {
-    ac_destroy_pipeline(bd->pipelines[0]);
+    ac_destroy_descriptor_buffer(db);
   }
-  if (bd->pipelines[1])
+  bd->texture_pages.clear();
+  bd->free_slots.clear();
+  bd->slot_kinds.clear();
+  for (ImVector<uint32_t>& released : bd->released_slots)
   {
-    ac_destroy_pipeline(bd->pipelines[1]);
+    released.clear();
   }
-  ac_destroy_descriptor_buffer(bd->db);
   ac_destroy_dsl(bd->dsl);
 
   ac_destroy_shader(bd->vertex_shader);
+  ac_destroy_shader(bd->packed_vertex_shader);
   ac_destroy_shader(bd->pixel_shader);
   ac_destroy_image(bd->font_image);
   ac_destroy_sampler(bd->font_sampler);
 }
 
-ac_result
-ac_imgui_renderer_init(const ac_imgui_renderer_init_info* info)
+// Multi-viewport support: the application owns the swapchains of secondary
+// viewports and renders viewport->DrawData with
+// ac_imgui_renderer_render_draw_data(), the backend only keeps separate render
+// buffers per viewport. The data of main viewports is created when a context
+// is attached.
+
+static void
+ImGui_ImplAC_CreateWindow(ImGuiViewport* viewport)
+{
+  viewport->RendererUserData = IM_NEW(ImGui_ImplAC_ViewportData)();
+}
+
+static void
+ImGui_ImplAC_DestroyWindow(ImGuiViewport* viewport)
+{
+  ImGui_ImplAC_ViewportData* vd =
+    (ImGui_ImplAC_ViewportData*)viewport->RendererUserData;
+  if (vd)
+  {
+    ImGui_ImplAC_RetireRingBuffer(&vd->RenderBuffers.vertex_ring);
+    ImGui_ImplAC_RetireRingBuffer(&vd->RenderBuffers.index_ring);
+    ImGui_ImplAC_RetireRingBuffer(&vd->RenderBuffers.device_ring);
+    ImGui_ImplAC_RetireListCache(&vd->RenderBuffers);
+    for (ImGui_ImplACH_CompositeEntry& entry : vd->RenderBuffers.composites)
+    {
+      ImGui_ImplAC_RetireComposite(&entry);
+    }
+    IM_DELETE(vd);
+  }
+  viewport->RendererUserData = nullptr;
+}
+
+// Makes bd the renderer of the current context
+static void
+ImGui_ImplAC_AttachContext(ImGui_ImplAC_Data* bd)
 {
   ImGuiIO& io = ImGui::GetIO();
   IM_ASSERT(
@@ -752,27 +3759,55 @@ ac_imgui_renderer_init(const ac_imgui_renderer_init_info* info)
     "Already initialized a renderer backend!");
 
   // Setup backend capabilities flags
-  ImGui_ImplAC_Data* bd = IM_NEW(ImGui_ImplAC_Data)();
   io.BackendRendererUserData = (void*)bd;
   io.BackendRendererName = "imgui_impl_vulkan";
   io.BackendFlags |=
     ImGuiBackendFlags_RendererHasVtxOffset; // We can honor the
                                             // ImDrawCmd::VtxOffset field,
                                             // allowing for large meshes.
+  io.BackendFlags |=
+    ImGuiBackendFlags_RendererHasViewports; // We can create multi-viewports
+                                            // on the Renderer side (optional)
+
+  ImGuiPlatformIO& platform_io = ImGui::GetPlatformIO();
+  platform_io.Renderer_CreateWindow = ImGui_ImplAC_CreateWindow;
+  platform_io.Renderer_DestroyWindow = ImGui_ImplAC_DestroyWindow;
+
+  // Contexts don't share upload records or list caches
+  ImGui_ImplAC_CreateWindow(ImGui::GetMainViewport());
+
+  bd->context_count++;
+}
+
+ac_result
+ac_imgui_renderer_init(const ac_imgui_renderer_init_info* info)
+{
+  ImGui_ImplAC_Data* bd = IM_NEW(ImGui_ImplAC_Data)();
+  ImGui_ImplAC_AttachContext(bd);
 
   IM_ASSERT(info->device);
   IM_ASSERT(
     info->frame_count > 0 && info->frame_count <= AC_MAX_FRAME_IN_FLIGHT);
+  IM_ASSERT(
+    (!info->indirect_draws || info->bindless_textures) &&
+    "Indirect draws take their texture from the bindless vertex stream");
+  IM_ASSERT(
+    (!info->cache_draw_lists ||
+     (!info->device_local_draw_buffers && !info->bindless_textures &&
+      !info->indirect_draws)) &&
+    "Cached draw lists only support the default draw path");
+  IM_ASSERT(
+    (!info->packed_vertices ||
+     (!info->bindless_textures && !info->indirect_draws &&
+      !info->cache_draw_lists)) &&
+    "Packed vertices only support the default draw path");
 
   bd->init_info = *info;
 
   ImGui_ImplAC_CreateDeviceObjects();
-
-  for (uint32_t j = 0; j < MAX_TEXTURES; ++j)
-  {
-    bd->stack[j] = j;
-  }
-  bd->stack_size = MAX_TEXTURES;
+  // The keys only have to outlive ac_imgui_renderer_init()
+  bd->init_info.pipeline_keys = nullptr;
+  bd->init_info.pipeline_key_count = 0;
 
   return ac_result_success;
 }
@@ -785,11 +3820,35 @@ ac_imgui_renderer_shutdown(void)
     bd != nullptr && "No renderer backend to shutdown, or already shutdown?");
   ImGuiIO& io = ImGui::GetIO();
 
-  ImGui_ImplAC_DestroyDeviceObjects();
+  // Retires the render buffers of all viewports, the main one included,
+  // before the garbage is destroyed
+  ImGui::DestroyPlatformWindows();
+  bool last_context = --bd->context_count == 0;
+  if (last_context)
+  {
+    ImGui_ImplAC_DestroyDeviceObjects();
+  }
   io.BackendRendererName = nullptr;
   io.BackendRendererUserData = nullptr;
-  io.BackendFlags &= ~ImGuiBackendFlags_RendererHasVtxOffset;
-  IM_DELETE(bd);
+  io.BackendFlags &= ~(
+    ImGuiBackendFlags_RendererHasVtxOffset |
+    ImGuiBackendFlags_RendererHasViewports);
+  if (last_context)
+  {
+    IM_DELETE(bd);
+  }
+}
+
+void
+ac_imgui_renderer_add_context(ImGuiContext* context)
+{
+  ImGui_ImplAC_Data* bd = ImGui_ImplAC_GetBackendData();
+  IM_ASSERT(bd != nullptr && "Did you call ac_imgui_renderer_init()?");
+
+  ImGuiContext* current = ImGui::GetCurrentContext();
+  ImGui::SetCurrentContext(context);
+  ImGui_ImplAC_AttachContext(bd);
+  ImGui::SetCurrentContext(current);
 }
 
 void
@@ -797,22 +3856,145 @@ ac_imgui_renderer_new_frame(void)
 {
   ImGui_ImplAC_Data* bd = ImGui_ImplAC_GetBackendData();
   IM_ASSERT(bd != nullptr && "Did you call ImGui_ImplAC_Init()?");
-  IM_UNUSED(bd);
+
+  ac_imgui_renderer_get_stats(&bd->last_stats);
+  memset(&bd->stats, 0, sizeof(bd->stats));
+  bd->composite_requests.resize(0);
+
+  bd->frame++;
+  bd->frame_index = (uint32_t)(bd->frame % bd->init_info.frame_count);
+
+  // Everything retired frame_count frames ago is no longer used by the GPU
+  int32_t kept = 0;
+  for (int32_t i = 0; i < bd->garbage.Size; ++i)
+  {
+    ImGui_ImplAC_Garbage& garbage = bd->garbage[i];
+    if (bd->frame - garbage.frame >= bd->init_info.frame_count)
+    {
+      ac_destroy_buffer(garbage.buffer);
+      ac_destroy_image(garbage.image);
+    }
+    else
+    {
+      bd->garbage[kept++] = garbage;
+    }
+  }
+  bd->garbage.resize(kept);
+
+  // Slots released while this frame index was last recorded are free again
+  ImVector<uint32_t>& released = bd->released_slots[bd->frame_index];
+  for (uint32_t slot : released)
+  {
+    bd->free_slots.push_back(slot);
+  }
+  released.resize(0);
+
+  ImGui_ImplAC_EnforceTextureBudget();
 }
 
-IMGUI_IMPL_API ImTextureID
-ac_imgui_renderer_create_texture(ac_image image)
+IMGUI_IMPL_API void
+ac_imgui_renderer_get_stats(ac_imgui_renderer_stats* stats)
+{
+  ImGui_ImplAC_Data* bd = ImGui_ImplAC_GetBackendData();
+  IM_ASSERT(bd != nullptr && "Did you call ImGui_ImplAC_Init()?");
+
+  *stats = bd->stats;
+
+  uint32_t pending = 0;
+  for (const ImVector<uint32_t>& released : bd->released_slots)
+  {
+    pending += (uint32_t)released.Size;
+  }
+  stats->texture_capacity = bd->init_info.bindless_textures
+                              ? MAX_TEXTURES
+                              : (uint32_t)bd->texture_pages.Size *
+                                  TEXTURE_PAGE_SIZE;
+  stats->textures_pending_release = pending;
+  stats->textures_used =
+    stats->texture_capacity - (uint32_t)bd->free_slots.Size - pending;
+  stats->texture_pages = (uint32_t)bd->texture_pages.Size;
+
+  stats->streamed_textures_resident = 0;
+  for (const ImGui_ImplACH_StreamedTexture& entry : bd->streamed_textures)
+  {
+    stats->streamed_textures_resident += entry.texture ? 1 : 0;
+  }
+  stats->streamed_texture_bytes = bd->streamed_texture_bytes;
+}
+
+IMGUI_IMPL_API void
+ac_imgui_renderer_show_stats_window(bool* p_open)
+{
+  ImGui_ImplAC_Data* bd = ImGui_ImplAC_GetBackendData();
+  IM_ASSERT(bd != nullptr && "Did you call ImGui_ImplAC_Init()?");
+
+  if (!ImGui::Begin("ac renderer", p_open))
+  {
+    ImGui::End();
+    return;
+  }
+
+  const ac_imgui_renderer_stats& st = bd->last_stats;
+  ImGui::Text(
+    "CPU: upload %.3f ms, record %.3f ms",
+    st.upload_cpu_ms,
+    st.record_cpu_ms);
+  ImGui::Text(
+    "Draw calls: %u, merged commands %u",
+    st.draw_calls,
+    st.draws_merged);
+  ImGui::Text(
+    "Elided: %u binds, %u scissors",
+    st.binds_elided,
+    st.scissors_elided);
+  ImGui::Text(
+    "Uploaded: %u vertices, %u indices",
+    st.vertices_uploaded,
+    st.indices_uploaded);
+  ImGui::Text(
+    "Bytes: %llu written, %llu copied",
+    (unsigned long long)st.bytes_written,
+    (unsigned long long)st.bytes_copied);
+  ImGui::Text(
+    "Buffer resizes: %u, pipelines created: %u, packed fallbacks: %u",
+    st.buffer_resizes,
+    st.pipelines_created,
+    st.packed_fallbacks);
+  ImGui::Text(
+    "Draw lists reused: %u, composites drawn %u, rendered %u",
+    st.draw_lists_reused,
+    st.composites_drawn,
+    st.composites_rendered);
+  ImGui::Text(
+    "Textures: %u used, %u pending release, %u capacity in %u pages",
+    st.textures_used,
+    st.textures_pending_release,
+    st.texture_capacity,
+    st.texture_pages);
+  ImGui::Text(
+    "Streamed: %u resident, %.1f MB, %u requests, %u evictions",
+    st.streamed_textures_resident,
+    (double)st.streamed_texture_bytes / (1024.0 * 1024.0),
+    st.texture_requests,
+    st.texture_evictions);
+
+  ImGui::End();
+}
+
+static ImTextureID
+ImGui_ImplAC_CreateTexture(ac_image image, uint8_t kind)
 {
   ImGui_ImplAC_Data*           bd = ImGui_ImplAC_GetBackendData();
   ac_imgui_renderer_init_info* v = &bd->init_info;
 
-  if (!bd->stack_size)
+  if (bd->free_slots.empty() && !ImGui_ImplAC_AddTexturePage())
   {
     return nullptr;
   }
 
-  bd->stack_size--;
-  uint32_t set = bd->stack[bd->stack_size];
+  uint32_t slot = bd->free_slots.back();
+  bd->free_slots.pop_back();
+  bd->slot_kinds[slot] = kind;
 
   ac_descriptor descriptor = {};
   descriptor.image = image;
@@ -822,9 +4004,93 @@ ac_imgui_renderer_create_texture(ac_image image)
   write.descriptors = &descriptor;
   write.type = ac_descriptor_type_srv_image;
 
-  ac_update_set(bd->db, ac_space1, set, 1, &write);
+  if (v->bindless_textures)
+  {
+    write.index = slot;
+    ac_update_set(bd->texture_pages[0], ac_space1, 0, 1, &write);
+  }
+  else
+  {
+    ac_update_set(
+      bd->texture_pages[slot / TEXTURE_PAGE_SIZE],
+      ac_space1,
+      slot % TEXTURE_PAGE_SIZE,
+      1,
+      &write);
+  }
+
+  return (ImTextureID)(uintptr_t)(slot + 1);
+}
+
+IMGUI_IMPL_API bool
+ac_imgui_renderer_draw_data_changed(ImDrawData* draw_data)
+{
+  ImGui_ImplAC_Data* bd = ImGui_ImplAC_GetBackendData();
+  IM_ASSERT(bd != nullptr && "Did you call ImGui_ImplAC_Init()?");
+
+  float display[6] = {
+    draw_data->DisplayPos.x,
+    draw_data->DisplayPos.y,
+    draw_data->DisplaySize.x,
+    draw_data->DisplaySize.y,
+    draw_data->FramebufferScale.x,
+    draw_data->FramebufferScale.y,
+  };
+  uint64_t hash = ImGui_ImplAC_Hash(display, sizeof(display), 0);
+  hash = ImGui_ImplAC_Hash(
+    &bd->texture_generation,
+    sizeof(bd->texture_generation),
+    hash);
+
+  bool has_callbacks = false;
+  for (int n = 0; n < draw_data->CmdListsCount; n++)
+  {
+    const ImDrawList* cmd_list = draw_data->CmdLists[n];
+    hash = ImGui_ImplAC_Hash(
+      cmd_list->CmdBuffer.Data,
+      cmd_list->CmdBuffer.size_in_bytes(),
+      hash);
+    hash = ImGui_ImplAC_Hash(
+      cmd_list->VtxBuffer.Data,
+      cmd_list->VtxBuffer.size_in_bytes(),
+      hash);
+    hash = ImGui_ImplAC_Hash(
+      cmd_list->IdxBuffer.Data,
+      cmd_list->IdxBuffer.size_in_bytes(),
+      hash);
+    for (const ImDrawCmd& cmd : cmd_list->CmdBuffer)
+    {
+      has_callbacks |= cmd.UserCallback != nullptr;
+    }
+  }
+
+  ImGui_ImplACH_WindowRenderBuffers* wrb =
+    ImGui_ImplAC_GetWindowRenderBuffers(draw_data);
+  // What user callbacks draw is unknown, assume it changes every frame
+  bool changed = has_callbacks || wrb->content_hash != hash;
+  wrb->content_hash = hash;
+  return changed;
+}
+
+IMGUI_IMPL_API void
+ac_imgui_renderer_composite_draw_list(const ImDrawList* draw_list)
+{
+  ImGui_ImplAC_Data* bd = ImGui_ImplAC_GetBackendData();
+  IM_ASSERT(bd != nullptr && "Did you call ImGui_ImplAC_Init()?");
+  IM_ASSERT(
+    !bd->init_info.bindless_textures && !bd->init_info.indirect_draws &&
+    "Composited draw lists need the per set texture binding");
+
+  if (!bd->composite_requests.contains(draw_list))
+  {
+    bd->composite_requests.push_back(draw_list);
+  }
+}
 
-  return (ImTextureID)(uintptr_t)set;
+IMGUI_IMPL_API ImTextureID
+ac_imgui_renderer_create_texture(ac_image image)
+{
+  return ImGui_ImplAC_CreateTexture(image, TEXTURE_COLOR);
 }
 
 IMGUI_IMPL_API void
@@ -837,8 +4103,307 @@ ac_imgui_renderer_destroy_texture(ImTextureID texture)
 
   ImGui_ImplAC_Data* bd = ImGui_ImplAC_GetBackendData();
 
-  auto& frame = bd->sets[bd->MainWindowRenderBuffers.Index];
+  bd->texture_generation++;
+
+  // The GPU may still sample the slot in the frames in flight
+  ImGui_ImplAC_ReleaseTexture(texture);
+}
+
+static ImGui_ImplACH_StreamedTexture*
+ImGui_ImplAC_GetStreamedTexture(ImTextureID texture)
+{
+  ImGui_ImplAC_Data* bd = ImGui_ImplAC_GetBackendData();
+  uintptr_t          id = (uintptr_t)texture;
+  IM_ASSERT((id & STREAMED_TEXTURE_BIT) && "Not a streamed texture");
+  ImGui_ImplACH_StreamedTexture* entry =
+    &bd->streamed_textures[(int)ImGui_ImplAC_GetStreamedTextureIndex(id)];
+  IM_ASSERT(entry->alive);
+  IM_ASSERT(
+    ImGui_ImplAC_GetStreamedTextureGeneration(id) == entry->generation &&
+    "Streamed texture used after being destroyed");
+  return entry;
+}
+
+IMGUI_IMPL_API ImTextureID
+ac_imgui_renderer_create_streamed_texture(
+  uint64_t    user_key,
+  ImTextureID placeholder)
+{
+  ImGui_ImplAC_Data* bd = ImGui_ImplAC_GetBackendData();
+  IM_ASSERT(
+    placeholder && !((uintptr_t)placeholder & STREAMED_TEXTURE_BIT) &&
+    "The placeholder has to be a regular texture");
+
+  uint32_t index;
+  if (!bd->free_streamed_textures.empty())
+  {
+    index = bd->free_streamed_textures.back();
+    bd->free_streamed_textures.pop_back();
+  }
+  else
+  {
+    index = (uint32_t)bd->streamed_textures.Size;
+    bd->streamed_textures.push_back(ImGui_ImplACH_StreamedTexture());
+  }
+
+  ImGui_ImplACH_StreamedTexture& entry = bd->streamed_textures[index];
+  uintptr_t                      generation = entry.generation;
+  memset(&entry, 0, sizeof(entry));
+  entry.user_key = user_key;
+  entry.placeholder = placeholder;
+  entry.generation = generation;
+  entry.alive = true;
+  return ImGui_ImplAC_MakeStreamedTextureID(index, generation);
+}
+
+IMGUI_IMPL_API void
+ac_imgui_renderer_destroy_streamed_texture(ImTextureID texture)
+{
+  if (!texture)
+  {
+    return;
+  }
+
+  ImGui_ImplAC_Data*             bd = ImGui_ImplAC_GetBackendData();
+  ImGui_ImplACH_StreamedTexture* entry =
+    ImGui_ImplAC_GetStreamedTexture(texture);
+  ImGui_ImplAC_EvictStreamedTexture(entry);
+  entry->alive = false;
+  entry->generation = (entry->generation + 1) & STREAMED_GENERATION_MASK;
+  bd->free_streamed_textures.push_back(
+    ImGui_ImplAC_GetStreamedTextureIndex((uintptr_t)texture));
+}
+
+IMGUI_IMPL_API void
+ac_imgui_renderer_provide_streamed_texture(
+  ImTextureID texture,
+  ac_image    image,
+  uint64_t    memory_size,
+  uint32_t    extent)
+{
+  ImGui_ImplAC_Data* bd = ImGui_ImplAC_GetBackendData();
+  uintptr_t          id = (uintptr_t)texture;
+  IM_ASSERT((id & STREAMED_TEXTURE_BIT) && "Not a streamed texture");
+  ImGui_ImplACH_StreamedTexture* entry =
+    &bd->streamed_textures[(int)ImGui_ImplAC_GetStreamedTextureIndex(id)];
+  // Requests may be served after their texture was destroyed, even after
+  // its entry was reused by another texture
+  if (
+    !entry->alive ||
+    ImGui_ImplAC_GetStreamedTextureGeneration(id) != entry->generation)
+  {
+    ac_destroy_image(image);
+    return;
+  }
+  if (!image)
+  {
+    return;
+  }
+
+  ImTextureID slot = ImGui_ImplAC_CreateTexture(image, TEXTURE_COLOR);
+  if (!slot)
+  {
+    ac_destroy_image(image);
+    entry->requested_extent = 0;
+    return;
+  }
+
+  uint32_t requested_extent = entry->requested_extent;
+  ImGui_ImplAC_EvictStreamedTexture(entry);
+  entry->texture = slot;
+  entry->image = image;
+  entry->memory_size = memory_size;
+  entry->extent = extent;
+  entry->requested_extent = requested_extent;
+  bd->streamed_texture_bytes += memory_size;
+
+  // Draws of the texture change without any change of the draw data
+  bd->texture_generation++;
+}
+
+static uint32_t
+ImGui_ImplAC_PackShapeParam(float v)
+{
+  float p = v * SHAPE_PARAM_SCALE + 0.5f;
+  p = p < 0.0f ? 0.0f : (p > (float)SHAPE_PARAM_MAX ? SHAPE_PARAM_MAX : p);
+  return (uint32_t)p;
+}
+
+// Writes a quad around the shape centered on center, spanning [-1, 1] along
+// axis and its normal in shape coordinates. The uvs hold them shifted by
+// -4 * (param + 1) for the packed rounding and thickness, below any uv of the
+// font atlas. The vertex shader recovers both, the pixel shader derives the
+// quad size in pixels from the shape coordinate derivatives.
+//
+// Shapes keep the font atlas bound, so they share the draw calls of the text
+// and widgets around them.
+static void
+ImGui_ImplAC_AddShape(
+  ImDrawList*   draw_list,
+  const ImVec2& center,
+  const ImVec2& axis,
+  const ImVec2& half_size,
+  ImU32         col,
+  float         rounding,
+  float         thickness)
+{
+  ImGui_ImplAC_Data* bd = ImGui_ImplAC_GetBackendData();
+  IM_ASSERT(
+    !bd->init_info.bindless_textures && !bd->init_info.indirect_draws &&
+    !bd->init_info.packed_vertices &&
+    "Shapes only support the default draw path");
+  IM_UNUSED(bd);
+
+  if (
+    (col & IM_COL32_A_MASK) == 0 || half_size.x <= 0.0f ||
+    half_size.y <= 0.0f)
+  {
+    return;
+  }
+
+  // Room for half of the outline and the antialiased fringe, from the
+  // thickness the shaders see
+  uint32_t packed_rounding = ImGui_ImplAC_PackShapeParam(rounding);
+  uint32_t packed_thickness = ImGui_ImplAC_PackShapeParam(thickness);
+  float    margin = packed_thickness / SHAPE_PARAM_SCALE * 0.5f + 1.0f;
+  ImVec2   extent(half_size.x + margin, half_size.y + margin);
+  ImVec2   normal(-axis.y, axis.x);
+  ImVec2   uv_offset(
+    -4.0f * (float)(packed_rounding + 1),
+    -4.0f * (float)(packed_thickness + 1));
+
+  ImTextureID font_texture = ImGui::GetIO().Fonts->TexID;
+  bool        push_font = draw_list->_CmdHeader.TextureId != font_texture;
+  if (push_font)
+  {
+    draw_list->PushTextureID(font_texture);
+  }
+  draw_list->PrimReserve(6, 4);
+  ImDrawIdx idx = (ImDrawIdx)draw_list->_VtxCurrentIdx;
+  draw_list->PrimWriteIdx(idx);
+  draw_list->PrimWriteIdx((ImDrawIdx)(idx + 1));
+  draw_list->PrimWriteIdx((ImDrawIdx)(idx + 2));
+  draw_list->PrimWriteIdx(idx);
+  draw_list->PrimWriteIdx((ImDrawIdx)(idx + 2));
+  draw_list->PrimWriteIdx((ImDrawIdx)(idx + 3));
+  static const float corners[4][2] = {{-1, -1}, {1, -1}, {1, 1}, {-1, 1}};
+  for (const float* corner : corners)
+  {
+    float  x = corner[0] * extent.x;
+    float  y = corner[1] * extent.y;
+    ImVec2 pos(
+      center.x + axis.x * x + normal.x * y,
+      center.y + axis.y * x + normal.y * y);
+    draw_list->PrimWriteVtx(
+      pos,
+      ImVec2(uv_offset.x + corner[0], uv_offset.y + corner[1]),
+      col);
+  }
+  if (push_font)
+  {
+    draw_list->PopTextureID();
+  }
+}
+
+void
+ac_imgui_renderer_add_rect_filled(
+  ImDrawList*   draw_list,
+  const ImVec2& p_min,
+  const ImVec2& p_max,
+  ImU32         col,
+  float         rounding)
+{
+  ImGui_ImplAC_AddShape(
+    draw_list,
+    ImVec2((p_min.x + p_max.x) * 0.5f, (p_min.y + p_max.y) * 0.5f),
+    ImVec2(1.0f, 0.0f),
+    ImVec2((p_max.x - p_min.x) * 0.5f, (p_max.y - p_min.y) * 0.5f),
+    col,
+    rounding,
+    0.0f);
+}
+
+void
+ac_imgui_renderer_add_rect(
+  ImDrawList*   draw_list,
+  const ImVec2& p_min,
+  const ImVec2& p_max,
+  ImU32         col,
+  float         rounding,
+  float         thickness)
+{
+  // Same half pixel inset as ImDrawList::AddRect()
+  ImVec2 a(p_min.x + 0.50f, p_min.y + 0.50f);
+  ImVec2 b(p_max.x - 0.49f, p_max.y - 0.49f);
+  ImGui_ImplAC_AddShape(
+    draw_list,
+    ImVec2((a.x + b.x) * 0.5f, (a.y + b.y) * 0.5f),
+    ImVec2(1.0f, 0.0f),
+    ImVec2((b.x - a.x) * 0.5f, (b.y - a.y) * 0.5f),
+    col,
+    rounding,
+    thickness);
+}
+
+void
+ac_imgui_renderer_add_circle_filled(
+  ImDrawList*   draw_list,
+  const ImVec2& center,
+  float         radius,
+  ImU32         col)
+{
+  // The shader clamps the rounding to the half size
+  ImGui_ImplAC_AddShape(
+    draw_list,
+    center,
+    ImVec2(1.0f, 0.0f),
+    ImVec2(radius, radius),
+    col,
+    FLT_MAX,
+    0.0f);
+}
+
+void
+ac_imgui_renderer_add_circle(
+  ImDrawList*   draw_list,
+  const ImVec2& center,
+  float         radius,
+  ImU32         col,
+  float         thickness)
+{
+  ImGui_ImplAC_AddShape(
+    draw_list,
+    center,
+    ImVec2(1.0f, 0.0f),
+    ImVec2(radius, radius),
+    col,
+    FLT_MAX,
+    thickness);
+}
 
-  frame.released[frame.released_size] = (uint32_t)(uintptr_t)texture;
-  frame.released_size++;
+void
+ac_imgui_renderer_add_line(
+  ImDrawList*   draw_list,
+  const ImVec2& p1,
+  const ImVec2& p2,
+  ImU32         col,
+  float         thickness)
+{
+  // A filled rectangle along the segment, with the half pixel offset of
+  // ImDrawList::AddLine()
+  float dx = p2.x - p1.x;
+  float dy = p2.y - p1.y;
+  float length = sqrtf(dx * dx + dy * dy);
+  if (length <= 0.0f)
+  {
+    return;
+  }
+  ImGui_ImplAC_AddShape(
+    draw_list,
+    ImVec2((p1.x + p2.x) * 0.5f + 0.5f, (p1.y + p2.y) * 0.5f + 0.5f),
+    ImVec2(dx / length, dy / length),
+    ImVec2(length * 0.5f, thickness * 0.5f),
+    col,
+    0.0f,
+    0.0f);
 }
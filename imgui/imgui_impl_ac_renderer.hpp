@@ -2,33 +2,337 @@
 #include "imgui.h"
 #include <ac/ac.h>
 
+typedef enum ac_imgui_renderer_blend_mode {
+  ac_imgui_renderer_blend_mode_alpha = 0,
+  // Vertex colors and textures hold premultiplied alpha
+  ac_imgui_renderer_blend_mode_premultiplied = 1,
+} ac_imgui_renderer_blend_mode;
+
+// Identifies a pipeline of the renderer cache, samples 0 means
+// ac_imgui_renderer_init_info::samples
+typedef struct ac_imgui_renderer_pipeline_key {
+  ac_format                    color_format;
+  uint32_t                     samples;
+  ac_imgui_renderer_blend_mode blend_mode;
+} ac_imgui_renderer_pipeline_key;
+
+typedef void (*ac_imgui_renderer_job_fn)(void* job_data, uint32_t job_index);
+
 typedef struct ac_imgui_renderer_init_info {
   ac_device device;
   uint32_t  frame_count;
   uint32_t  samples;
+  // Store indices and vertices of a frame in one buffer instead of two
+  bool      merge_draw_buffers;
+  // Stage draw data in host memory and copy it into gpu_only buffers, requires
+  // ac_imgui_renderer_upload_draw_data() to be recorded outside of rendering
+  bool      device_local_draw_buffers;
+  // Bind all textures once as an array indexed per vertex, which lets
+  // consecutive commands with different textures share a draw call
+  bool      bindless_textures;
+  // Submit the whole draw data with a few indirect draws, clipping in the
+  // pixel shader. Requires bindless_textures.
+  bool      indirect_draws;
+  // Keep a GPU copy of every draw list and only upload lists whose content
+  // changed. Not compatible with device_local_draw_buffers, bindless_textures
+  // or indirect_draws.
+  bool      cache_draw_lists;
+  // Upload 12 byte vertices with positions rounded to a quarter pixel and 16
+  // bit uvs instead of the 20 byte ImDrawVert. Positions are stored relative
+  // to DisplayPos. Draw data reaching outside [-8192, 8192) of it or with uvs
+  // outside [0, 1] is uploaded as ImDrawVert. Draw ranges always upload
+  // ImDrawVert. Only for the default draw path, not with bindless_textures,
+  // indirect_draws or cache_draw_lists.
+  bool      packed_vertices;
+  // Keep a CPU copy of the font atlas so a rebuild of the same size only
+  // uploads the 32 row bands that changed, into the same texture. Pays off
+  // when the atlas is rebuilt with mostly the same content, a resized or added
+  // font usually moves most glyphs.
+  bool      partial_font_updates;
   void (*check_ac_result_fn)(ac_result err);
+  // Optional, runs job(job_data, i) for i in [0, job_count) on worker threads
+  // and returns once all are done. Used to copy large draw data in parallel.
+  void (*parallel_for_fn)(
+    uint32_t                 job_count,
+    ac_imgui_renderer_job_fn job,
+    void*                    job_data,
+    void*                    user_data);
+  void* parallel_for_user_data;
+  // Pipelines created by ac_imgui_renderer_init() so the first frames
+  // rendering into these targets don't compile them
+  const ac_imgui_renderer_pipeline_key* pipeline_keys;
+  uint32_t                              pipeline_key_count;
+  // Optional, called with begin true and false around the draws of every
+  // render and of every draw list, named after its window, so the application
+  // can record its own timestamp or pipeline statistics queries
+  void (*gpu_scope_fn)(
+    ac_cmd      command_buffer,
+    const char* name,
+    bool        begin,
+    void*       user_data);
+  void* gpu_scope_user_data;
+  // Streamed textures, see ac_imgui_renderer_create_streamed_texture().
+  // request_fn asks for an image of the texture whose larger side covers
+  // extent pixels, it may provide it right away or later. Resident images not
+  // drawn in the last frame are evicted, least recently drawn first, while
+  // their memory exceeds texture_budget bytes. Zero means no budget.
+  void (*texture_request_fn)(
+    ImTextureID texture,
+    uint64_t    user_key,
+    uint32_t    extent,
+    void*       user_data);
+  void*    texture_request_user_data;
+  uint64_t texture_budget;
 } ac_imgui_renderer_init_info;
 
+typedef struct ac_imgui_renderer_render_info {
+  // An sRGB color_format makes the shaders linearize vertex colors, so they
+  // blend in linear space and come out as authored
+  ac_imgui_renderer_pipeline_key target;
+  // Pixel position of the top left corner of the draw data in the target,
+  // e.g. an atlas tile
+  int32_t                        target_offset[2];
+  // x, y, width and height in pixels of the target area drawing is clipped
+  // to, which is also the scissor left set afterwards. A zero width or height
+  // uses the framebuffer size of the draw data at target_offset.
+  int32_t                        target_rect[4];
+} ac_imgui_renderer_render_info;
+
+// Per frame counters, reset by ac_imgui_renderer_new_frame()
+typedef struct ac_imgui_renderer_stats {
+  uint32_t draw_calls;
+  // Sampler and texture binds skipped because the same set was bound
+  uint32_t binds_elided;
+  uint32_t scissors_elided;
+  // Commands folded into the draw call of the previous command
+  uint32_t draws_merged;
+  // Draw lists unchanged since their last upload, cache_draw_lists only
+  uint32_t draw_lists_reused;
+  // Lists drawn as a quad from their offscreen image, and how many of those
+  // images had to be rendered again
+  uint32_t composites_drawn;
+  uint32_t composites_rendered;
+  // Texture slot occupancy, sampled when the stats are queried
+  uint32_t textures_used;
+  uint32_t textures_pending_release;
+  uint32_t texture_capacity;
+  uint32_t texture_pages;
+  // Pipelines compiled this frame because their key was not cached
+  uint32_t pipelines_created;
+  // Geometry written this frame, bytes written to mapped memory and bytes
+  // copied by the GPU with device_local_draw_buffers
+  uint32_t vertices_uploaded;
+  uint32_t indices_uploaded;
+  uint64_t bytes_written;
+  uint64_t bytes_copied;
+  // Ring and draw list cache buffers replaced by bigger ones
+  uint32_t buffer_resizes;
+  // Uploads done with ImDrawVert because a position or uv was out of the
+  // packed range, packed_vertices only
+  uint32_t packed_fallbacks;
+  // CPU time spent uploading and recording draws, in milliseconds
+  float    upload_cpu_ms;
+  float    record_cpu_ms;
+  // Streamed texture requests and evictions this frame, and the resident
+  // images sampled when the stats are queried
+  uint32_t texture_requests;
+  uint32_t texture_evictions;
+  uint32_t streamed_textures_resident;
+  uint64_t streamed_texture_bytes;
+} ac_imgui_renderer_stats;
+
 IMGUI_IMPL_API ac_result
 ac_imgui_renderer_init(const ac_imgui_renderer_init_info* info);
 IMGUI_IMPL_API void
 ac_imgui_renderer_shutdown(void);
 IMGUI_IMPL_API void
 ac_imgui_renderer_new_frame(void);
+
+// Shares the renderer of the current context with context, which then uses
+// its textures and pipelines. Rings and caches stay per context, so each one
+// can upload before any of them renders. Create the contexts with one
+// ImFontAtlas so they also share the font texture. Every context calls
+// ac_imgui_renderer_shutdown() with itself current, the renderer is destroyed
+// with the last one. ac_imgui_renderer_new_frame() is called once per frame
+// for all of them.
+IMGUI_IMPL_API void
+ac_imgui_renderer_add_context(ImGuiContext* context);
+
+// Renders the draw data of several contexts in one pass. Their geometry is
+// uploaded as a single range, info i gives the target of draw_datas[i].
+// Upload calls are needed with device_local_draw_buffers and have to pass the
+// same draw data in the same order. Not available with indirect_draws or
+// cache_draw_lists.
+IMGUI_IMPL_API void
+ac_imgui_renderer_upload_draw_data_batch(
+  ImDrawData* const* draw_datas,
+  uint32_t           count,
+  ac_cmd             command_buffer);
+IMGUI_IMPL_API void
+ac_imgui_renderer_render_draw_data_batch(
+  ImDrawData* const*                   draw_datas,
+  const ac_imgui_renderer_render_info* infos,
+  uint32_t                             count,
+  ac_cmd                               command_buffer);
+
+// Multi-viewport: every secondary viewport gets its own render buffers, but
+// the renderer creates no swapchains. imgui_impl_ac_window drives a single
+// window and does not set ImGuiBackendFlags_PlatformHasViewports, a platform
+// backend which owns more windows sets it along with the Platform_ callbacks
+// and renders every viewport into its window after ImGui::Render():
+//
+//   ImGui::UpdatePlatformWindows();
+//   for (ImGuiViewport* viewport : ImGui::GetPlatformIO().Viewports)
+//     if (viewport->DrawData)
+//       ac_imgui_renderer_upload_draw_data(viewport->DrawData, cmd);
+//   for (ImGuiViewport* viewport : ImGui::GetPlatformIO().Viewports)
+//     if (viewport->DrawData)
+//       // Inside rendering into the window of viewport->PlatformHandle
+//       ac_imgui_renderer_render_draw_data(viewport->DrawData, format, cmd);
+IMGUI_IMPL_API void
+ac_imgui_renderer_upload_draw_data(
+  ImDrawData* draw_data,
+  ac_cmd      command_buffer);
 IMGUI_IMPL_API void
 ac_imgui_renderer_render_draw_data(
   ImDrawData* draw_data,
   ac_format   color_format,
   ac_cmd      command_buffer);
+IMGUI_IMPL_API void
+ac_imgui_renderer_render_draw_data_ex(
+  ImDrawData*                          draw_data,
+  const ac_imgui_renderer_render_info* info,
+  ac_cmd                               command_buffer);
+
+// Parallel recording: begin splits the draw data into at most range_count
+// ranges and reserves their vertices and indices, it writes the ranges to
+// ranges and returns their number. info gives the target of every range, as
+// for ac_imgui_renderer_render_draw_data_ex(). Every range can then copy and
+// record its draws on its own thread into a command buffer executed inside
+// the rendering pass, without reading the current ImGui context. User
+// callbacks run on that thread. End is called on the render thread once all
+// ranges are recorded, which invalidates them. Not available with
+// indirect_draws or cache_draw_lists.
+typedef struct ImGui_ImplACH_DrawRange* ac_imgui_renderer_draw_range;
+
+IMGUI_IMPL_API uint32_t
+ac_imgui_renderer_begin_draw_ranges(
+  ImDrawData*                          draw_data,
+  const ac_imgui_renderer_render_info* info,
+  uint32_t                             range_count,
+  ac_imgui_renderer_draw_range*        ranges,
+  ac_cmd                               command_buffer);
+IMGUI_IMPL_API void
+ac_imgui_renderer_record_draw_range(
+  ac_imgui_renderer_draw_range range,
+  ac_cmd                       command_buffer);
+IMGUI_IMPL_API void
+ac_imgui_renderer_end_draw_ranges(ImDrawData* draw_data);
+
+IMGUI_IMPL_API void
+ac_imgui_renderer_get_stats(ac_imgui_renderer_stats* stats);
+
+// Shows the stats of the previous frame in a window, next to
+// ImGui::ShowMetricsWindow()
+IMGUI_IMPL_API void
+ac_imgui_renderer_show_stats_window(bool* p_open);
 
+// Hashes the draw data and returns whether it differs from the last call for
+// the same viewport. Unchanged draw data can skip rendering and presenting.
+IMGUI_IMPL_API bool
+ac_imgui_renderer_draw_data_changed(ImDrawData* draw_data);
+
+// Records the atlas upload into command_buffer, which has to be submitted
+// before the first render using the atlas. Call again after rebuilding the
+// atlas: with partial_font_updates an atlas of the same size only uploads the
+// rows that changed into the existing image, otherwise the previous image is
+// released once the frames in flight retire.
 IMGUI_IMPL_API ac_result
+ac_imgui_renderer_create_font_texture(ac_cmd command_buffer);
 
-ac_imgui_renderer_create_font_texture(void);
+// Renders draw_list into an offscreen image and draws it as a single quad,
+// the image is only rendered again when the list content changes. Call every
+// frame between ImGui::NewFrame() and the upload, e.g. with
+// ImGui::GetWindowDrawList(). The offscreen rendering is recorded by
+// ac_imgui_renderer_upload_draw_data(), which has to be called before
+// rendering the draw data, and is not available with bindless_textures or
+// indirect_draws.
 IMGUI_IMPL_API void
-ac_imgui_renderer_destroy_font_upload_objects(void);
+ac_imgui_renderer_composite_draw_list(const ImDrawList* draw_list);
 
+// Returns nullptr when no texture slot can be allocated
 IMGUI_IMPL_API ImTextureID
 ac_imgui_renderer_create_texture(ac_image image);
 
 IMGUI_IMPL_API void
 ac_imgui_renderer_destroy_texture(ImTextureID texture);
+
+// Returns a texture id which only holds a descriptor and an image while it is
+// drawn. Draws using it are tracked during the upload, missing images are
+// asked from texture_request_fn with user_key and drawn with placeholder until
+// they are provided.
+IMGUI_IMPL_API ImTextureID
+ac_imgui_renderer_create_streamed_texture(
+  uint64_t    user_key,
+  ImTextureID placeholder);
+
+IMGUI_IMPL_API void
+ac_imgui_renderer_destroy_streamed_texture(ImTextureID texture);
+
+// Hands the image requested for texture to the renderer, which owns it from
+// then on. memory_size counts against texture_budget. A null image fails the
+// request, it is only repeated for a bigger extent. The image of a request
+// whose texture was destroyed in the meantime is destroyed.
+IMGUI_IMPL_API void
+ac_imgui_renderer_provide_streamed_texture(
+  ImTextureID texture,
+  ac_image    image,
+  uint64_t    memory_size,
+  uint32_t    extent);
+
+// Shapes drawn as a single quad whose coverage the pixel shader evaluates
+// analytically, instead of being tessellated by ImDrawList. They follow the
+// geometry of the matching ImDrawList functions, outlines are centered on the
+// shape edge. Shapes are drawn with the font atlas and share draw calls with
+// the text around them. Parameters are quantized to 1/16 and clamped below
+// 2048, circles larger than that lose their roundness. Not available with
+// bindless_textures, indirect_draws or packed_vertices.
+IMGUI_IMPL_API void
+ac_imgui_renderer_add_rect_filled(
+  ImDrawList*   draw_list,
+  const ImVec2& p_min,
+  const ImVec2& p_max,
+  ImU32         col,
+  float         rounding);
+
+IMGUI_IMPL_API void
+ac_imgui_renderer_add_rect(
+  ImDrawList*   draw_list,
+  const ImVec2& p_min,
+  const ImVec2& p_max,
+  ImU32         col,
+  float         rounding,
+  float         thickness);
+
+IMGUI_IMPL_API void
+ac_imgui_renderer_add_circle_filled(
+  ImDrawList*   draw_list,
+  const ImVec2& center,
+  float         radius,
+  ImU32         col);
+
+IMGUI_IMPL_API void
+ac_imgui_renderer_add_circle(
+  ImDrawList*   draw_list,
+  const ImVec2& center,
+  float         radius,
+  ImU32         col,
+  float         thickness);
+
+IMGUI_IMPL_API void
+ac_imgui_renderer_add_line(
+  ImDrawList*   draw_list,
+  const ImVec2& p1,
+  const ImVec2& p2,
+  ImU32         col,
+  float         thickness);
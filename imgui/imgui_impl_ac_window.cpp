@@ -1,9 +1,18 @@
 #include "imgui.h"
 #include "imgui_impl_ac_window.hpp"
 
+// Seconds still updated after the last event on top of
+// ImGuiStyle::HoverDelayNormal, the longest hover timer of ImGui, so delayed
+// tooltips and animations settle
+static constexpr float SETTLE_MARGIN = 0.1f;
+
 struct ImGui_ImplAc_Data {
   uint64_t time;
   ImVec2   virtual_cursor_pos;
+  // Set by the callbacks, consumed by ac_imgui_window_new_frame
+  bool     pending_events;
+  // time of the first frame after the last event
+  uint64_t event_time;
 
   ImGui_ImplAc_Data()
   {
@@ -245,6 +254,8 @@ ac_imgui_window_init(void)
   ImGui_ImplAc_Data* bd = IM_NEW(ImGui_ImplAc_Data)();
   io.BackendPlatformUserData = (void*)bd;
   io.BackendPlatformName = "imgui_impl_ac";
+  // ac exposes a single window, so ImGuiBackendFlags_PlatformHasViewports is
+  // left to platform backends which can create more
   io.ConfigFlags |= ImGuiConfigFlags_NavEnableGamepad;
 
   ac_window_state state = ac_window_get_state();
@@ -259,6 +270,8 @@ ac_imgui_window_init(void)
 
 
   bd->time = 0;
+  // Settle the first frames as if an event had arrived
+  bd->pending_events = true;
 
   return ac_result_success;
 }
@@ -297,10 +310,28 @@ ac_imgui_window_new_frame()
   }
   bd->time = current_time;
 
+  if (bd->pending_events)
+  {
+    bd->pending_events = false;
+    bd->event_time = current_time;
+  }
+
   // Update game controllers (if enabled and available)
   // ImGui_ImplAc_UpdateGamepads();
 }
 
+IMGUI_IMPL_API bool
+ac_imgui_window_wants_update()
+{
+  ImGui_ImplAc_Data* bd = ImGui_ImplAc_GetBackendData();
+  IM_ASSERT(bd != nullptr && "Did you call ac_imgui_window_init()?");
+
+  // The caret of an active text input blinks without any event
+  float settle_time = ImGui::GetStyle().HoverDelayNormal + SETTLE_MARGIN;
+  return bd->pending_events || ImGui::GetIO().WantTextInput ||
+         bd->time - bd->event_time < (uint64_t)(settle_time * 1000.0f);
+}
+
 IMGUI_IMPL_API void
 ac_imgui_input_callback(const ac_input_event* event)
 {
@@ -311,6 +342,8 @@ ac_imgui_input_callback(const ac_input_event* event)
     return;
   }
 
+  bd->pending_events = true;
+
   ImGuiIO& io = ImGui::GetIO();
 
   switch (event->type)
@@ -402,6 +435,8 @@ ac_imgui_window_callback(const ac_window_event* event)
     return;
   }
 
+  bd->pending_events = true;
+
   ImGuiIO& io = ImGui::GetIO();
 
   switch (event->type)
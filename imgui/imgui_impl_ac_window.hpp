@@ -9,6 +9,11 @@ IMGUI_IMPL_API void
 ac_imgui_window_shutdown();
 IMGUI_IMPL_API void
 ac_imgui_window_new_frame();
+// False once no event arrived for longer than the ImGui hover delays and no
+// text input is active, the application may then skip the frame and keep
+// presenting the previous image
+IMGUI_IMPL_API bool
+ac_imgui_window_wants_update();
 
 IMGUI_IMPL_API void
 ac_imgui_input_callback(const ac_input_event* event);
@@ -3,7 +3,7 @@ include("../../ac/premake/ac_common_settings")
 project("ac-imgui-shaders")
   kind("Utility")
 
-  ac_compile_shader("imgui.acsl", "vs fs")
+  ac_compile_shader("imgui.acsl", "vs fs vs_bindless fs_bindless vs_indirect fs_indirect vs_packed")
 
 project("ac-imgui")
   warnings("Off")